@@ -0,0 +1,56 @@
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// BATTERY MONITOR
+// Takes one calibrated ADC sample every few seconds (no busy-wait bursts),
+// smooths the voltage with a scalar Kalman filter and fits the percentage
+// trend over the last couple of hours to estimate discharge rate and time
+// remaining.
+// ============================================================================
+
+class BatteryMonitor {
+public:
+    BatteryMonitor();
+
+    // Configure the ADC pin and seed the filter
+    void init();
+
+    // Take a sample when one is due - cheap, call every loop
+    void loop();
+
+    float getVoltage() const;               // Filtered voltage
+    int getPercent() const;
+    float getDischargeRatePerHour() const;  // %/h, positive while discharging
+    float getHoursRemaining() const;        // -1 when unknown or charging
+    bool isCharging() const;
+
+    // Filter has settled - don't act on low-battery readings before this
+    bool isReliable() const;
+
+private:
+    // Kalman state (volts)
+    float estimate;
+    float errorCovariance;
+    int sampleCount;
+    unsigned long lastSample;
+
+    // Percentage trend, one point per BATTERY_TREND_INTERVAL_MS
+    float trendPercent[BATTERY_TREND_POINTS];
+    unsigned long trendTime[BATTERY_TREND_POINTS];
+    int trendHead;
+    int trendCount;
+    unsigned long lastTrendPoint;
+    float slopePerHour;     // Least-squares slope of the trend, %/h (negative = discharging)
+
+    float readVoltage();
+    float voltageToPercent(float voltage) const;
+    void addTrendPoint(unsigned long now);
+};
+
+extern BatteryMonitor batteryMonitor;
+
+#endif // BATTERY_MONITOR_H
@@ -0,0 +1,82 @@
+#ifndef BLACK_BOX_H
+#define BLACK_BOX_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// BLACK BOX RECORDER
+// Ring of recent fetch cycle records kept in RTC memory, which survives
+// watchdog and panic resets. Each record is updated in place as the cycle
+// moves through its phases, so after a hang the last record shows where it
+// stopped. The timetable is drawn on the render task after the fetch is
+// done, so a cycle stays in the render phase until that task reports the
+// draw time. Published once over MQTT after the next boot, and always
+// available from the web API at /api/blackbox.
+// ============================================================================
+
+enum CyclePhase : uint8_t {
+    PHASE_IDLE,
+    PHASE_START,        // Cycle begun, nothing sent yet
+    PHASE_HTTP,         // Waiting on an HTTP request
+    PHASE_PARSE,        // Parsing a response
+    PHASE_RENDER,       // Fetch done, render task composing and pushing to the EPD
+    PHASE_DONE
+};
+
+struct CycleRecord {
+    uint32_t uptimeS;       // Uptime when the cycle started
+    uint32_t epoch;         // Wall clock when the cycle started (0 if unknown)
+    uint32_t httpMs;        // Time spent waiting on HTTP
+    uint32_t parseMs;       // Time spent parsing responses
+    uint32_t renderMs;      // Time the render task spent drawing the timetable
+    uint32_t heapMin;       // Lowest free heap seen during the cycle
+    int16_t lastHttpCode;
+    uint16_t budgetUsed;    // API calls used today at the end of the cycle
+    uint8_t phase;          // Last phase reached - anything but DONE never finished
+    uint8_t apiCalls;
+    uint8_t busCount;
+    uint8_t success;
+};
+
+class BlackBox {
+public:
+    BlackBox();
+
+    // Validate the RTC ring and capture the reset reason (call early in setup)
+    void init();
+
+    // Cycle recording
+    void beginCycle(int budgetUsed);
+    void markPhase(CyclePhase phase);
+    void noteHttpCode(int httpCode);
+    void endCycle(bool success, int busCount, int apiCalls, int budgetUsed);
+
+    // The cycle's timetable is on the panel (called from the render task)
+    void noteRender(uint32_t ms);
+
+    // Report from the previous boot still needs publishing
+    bool hasPendingReport() const;
+    void markReported();
+
+    // JSON dump of the ring (newest last) plus boot info
+    String toJson() const;
+
+    const char* getResetReasonName() const;
+
+private:
+    bool cycleOpen;
+    bool pendingReport;
+    CyclePhase currentPhase;
+    unsigned long phaseStart;
+    int renderRecord;       // Ring index waiting on noteRender(), -1 if none
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;  // Render task writes too
+
+    CycleRecord* current();
+    void accumulatePhaseTime(unsigned long now, uint32_t heap);
+    void seal();  // Update checksum after a write
+};
+
+extern BlackBox blackBox;
+
+#endif // BLACK_BOX_H
@@ -0,0 +1,79 @@
+#ifndef CLOCK_SERVICE_H
+#define CLOCK_SERVICE_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <time.h>
+#include "config.h"
+
+// ============================================================================
+// CLOCK SERVICE
+// Cached local time that never blocks. getLocalTime() waits up to 5 seconds
+// when the clock is not yet set, so hot paths read a snapshot from here
+// instead. Small backward corrections of the system clock are held off so
+// the snapshot never runs backwards between two reads.
+//
+// The wall clock is set from SNTP or from the Date header of our own API
+// responses, whichever arrives first, so networks that block NTP still
+// get a valid clock after the first fetch.
+// ============================================================================
+
+enum ClockSource : uint8_t {
+    CLOCK_SOURCE_NONE,
+    CLOCK_SOURCE_HTTP,      // Date header of an HTTP response (1 s resolution)
+    CLOCK_SOURCE_SNTP
+};
+
+struct ClockSnapshot {
+    bool valid;             // False until the wall clock has been set
+    time_t epoch;           // Seconds since 1970 (UTC)
+    struct tm local;        // Broken-down local time (UK, GMT/BST)
+    int minuteOfDay;        // local.tm_hour * 60 + local.tm_min
+    int dayOfMonth;         // local.tm_mday
+    int dayOfWeek;          // local.tm_wday (0 = Sunday)
+};
+
+class ClockService {
+public:
+    ClockService();
+
+    // Set the timezone and start SNTP in the background (never waits)
+    void init();
+
+    // Ask an HTTPClient to keep the Date header (call after begin())
+    void watchDateHeader(HTTPClient& http);
+
+    // Set or discipline the clock from the Date header of a finished request
+    void syncFromResponse(HTTPClient& http);
+
+    // Parse an RFC 7231 date ("Sun, 06 Nov 1994 08:49:37 GMT"), 0 on failure
+    static time_t parseHttpDate(const String& value);
+
+    // Current time snapshot - cheap, recomputed at most once per second.
+    // Returned by value: the render task reads it from the other core.
+    ClockSnapshot now();
+
+    bool isValid();
+
+    // "HH:MM" for the current time, or "--:--" when not valid
+    String formatHHMM();
+
+    ClockSource getSource() const;
+    const char* getSourceName() const;
+
+private:
+    ClockSnapshot snapshot;         // Guarded by lock
+    unsigned long lastRefresh;      // millis() of the last recompute, guarded by lock
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile ClockSource source;    // Written from the SNTP callback
+    unsigned long lastSntpSync;     // millis() of the last SNTP sync
+
+    static void onSntpSync(struct timeval* tv);
+    void setTime(time_t epoch, ClockSource from);
+
+    ClockSnapshot refresh(unsigned long nowMs);
+};
+
+extern ClockService clockService;
+
+#endif // CLOCK_SERVICE_H
@@ -23,6 +23,28 @@
 #define WIFI_CONNECT_TIMEOUT_MS 30000
 #define WIFI_RETRY_DELAY_MS 500
 
+// Fast reconnect: direct association to the cached BSSID/channel before scanning
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000       // Give up on the fast path after this
+#define WIFI_REUSE_LAST_IP false                // Reuse the last DHCP lease (only if the router reserves it)
+#define WIFI_STATIC_IP ""                       // Optional fixed address, e.g. "192.168.1.60"
+#define WIFI_STATIC_GATEWAY ""
+#define WIFI_STATIC_SUBNET "255.255.255.0"
+#define WIFI_STATIC_DNS ""                      // Defaults to the gateway
+
+// Background reconnect backoff after a link drop
+#define CONN_BACKOFF_MIN_MS 2000
+#define CONN_BACKOFF_MAX_MS 300000              // 5 minutes
+
+// ----------------------------------------------------------------------------
+// TIME SYNCHRONIZATION
+// SNTP runs in the background; API response Date headers also set the clock
+// ----------------------------------------------------------------------------
+#define NTP_SERVER_1 "pool.ntp.org"
+#define NTP_SERVER_2 "time.nist.gov"
+#define CLOCK_SYNC_FROM_HTTP true               // Use the Date header of API responses
+#define CLOCK_HTTP_MAX_DRIFT_S 2                // Re-set from HTTP when off by more than this
+#define CLOCK_SNTP_STALE_MS 7200000             // Let HTTP correct the clock if SNTP is silent this long
+
 // ----------------------------------------------------------------------------
 // MQTT CONFIGURATION (Home Assistant Auto-Discovery)
 // ----------------------------------------------------------------------------
@@ -31,6 +53,10 @@
 #define MQTT_USER SECRET_MQTT_USER
 #define MQTT_PASSWORD SECRET_MQTT_PASSWORD
 #define MQTT_CLIENT_ID SECRET_MQTT_CLIENT_ID
+#define MQTT_RECONNECT_MIN_MS 5000              // Reconnect backoff (doubles per failure)
+#define MQTT_RECONNECT_MAX_MS 120000
+#define MQTT_SOCKET_TIMEOUT_S 5                 // Cap on a connect to a dead broker
+#define MQTT_CONNECT_TASK_STACK 4096            // Helper task that dials the broker off the loop
 
 // Home Assistant Discovery prefix
 #define HA_DISCOVERY_PREFIX "homeassistant"
@@ -39,6 +65,34 @@
 #define MQTT_STATE_TOPIC "bus_timetable/state"
 #define MQTT_AVAILABILITY_TOPIC "bus_timetable/availability"
 #define MQTT_COMMAND_TOPIC "bus_timetable/command"
+#define MQTT_BLACKBOX_TOPIC "bus_timetable/blackbox"  // Cycle records from before the last reboot
+#define MQTT_BUFFER_SIZE 2048                   // Discovery configs and fleet snapshots
+#define MQTT_MAX_EXTRA_SUBSCRIPTIONS 4
+
+// ----------------------------------------------------------------------------
+// FLEET MODE
+// Displays sharing a broker elect one leader that fetches for all of them.
+// ----------------------------------------------------------------------------
+#define FLEET_ENABLED false
+#define FLEET_TOPIC_PREFIX "bus_timetable/fleet"
+#define FLEET_LEASE_MS 180000                   // Followers take over after this without a renewal
+#define FLEET_RENEW_MS 60000                    // Leader renews, followers re-send their direction
+#define FLEET_SETTLE_MS 3000                    // Wait for retained messages after joining
+#define FLEET_CLAIM_STAGGER_MS 10000            // Max per-device offset on claims
+#define FLEET_DEMAND_TTL_MS 180000              // Leader stops fetching a direction nobody asks for
+#define FLEET_MAX_DEPARTURES 6
+
+// ----------------------------------------------------------------------------
+// PRESENCE GATING
+// Optional MQTT topics from Home Assistant (e.g. a person entity via an
+// automation, or a motion sensor near the display). While nobody is home the
+// display stops fetching and only shows the clock. Empty topics disable it.
+// ----------------------------------------------------------------------------
+#define PRESENCE_TOPIC ""                       // "home" / "on" / "occupied" = someone home
+#define PRESENCE_MOTION_TOPIC ""                // "on" / "detected" = motion near the display
+#define PRESENCE_AWAY_GRACE_MS 600000           // House empty this long before fetching stops
+#define PRESENCE_MOTION_HOLD_MS 900000          // Motion keeps the timetable up this long
+#define PRESENCE_AWAY_CLOCK_MS 300000           // Clock redraw interval while away
 
 // ----------------------------------------------------------------------------
 // API SELECTION
@@ -52,6 +106,8 @@
 #define TRANSPORT_API_ID SECRET_TRANSPORT_API_ID
 #define TRANSPORT_API_KEY SECRET_TRANSPORT_API_KEY
 #define TRANSPORT_API_BASE "https://transportapi.com"
+#define TRANSPORT_API_HOST "transportapi.com"
+#define TRANSPORT_API_GZIP true                // Ask for gzip-compressed JSON
 
 // ----------------------------------------------------------------------------
 // NEXTBUS/TRAVELINE API CONFIGURATION (NEW - PRIMARY API)
@@ -60,7 +116,11 @@
 #define NEXTBUS_API_PASSWORD SECRET_NEXTBUS_PASSWORD
 // Traveline Nextbus API endpoint (from official documentation v2.7)
 // Uses HTTP (not HTTPS) and SIRI-SM XML format
+// To share one API budget between displays, point all three at siri_proxy.py,
+// e.g. "http://192.168.1.10:8080/nextbuses/1.0/1", "192.168.1.10", 8080
 #define NEXTBUS_API_BASE "http://nextbus.mxdata.co.uk/nextbuses/1.0/1"
+#define NEXTBUS_API_HOST "nextbus.mxdata.co.uk"
+#define NEXTBUS_API_PORT 80
 #define NEXTBUS_API_DAILY_LIMIT 1000  // Max API calls per day (180,000 per 6 months = ~1000/day)
 
 // Bus stops configuration - To Cheltenham direction
@@ -96,6 +156,24 @@
 #define DISPLAY_FULL_REFRESH_INTERVAL 3600000  // Full refresh every hour (ms)
 #define DISPLAY_PARTIAL_REFRESH_INTERVAL 60000 // Partial refresh every minute
 
+// Regions one update transaction can hold before they fold into one band
+#define DISPLAY_MAX_PENDING_AREAS 6
+
+// ----------------------------------------------------------------------------
+// TASK LAYOUT
+// Network and parsing run on core 0 beside the WiFi stack; composition and
+// the EPD push run on core 1. false keeps everything on the Arduino loop.
+// ----------------------------------------------------------------------------
+#define DUAL_CORE_TASKS true
+#define NET_TASK_CORE 0
+#define NET_TASK_STACK 16384                   // TLS handshakes need the room
+#define NET_TASK_PRIORITY 1
+#define RENDER_TASK_CORE 1
+#define RENDER_TASK_STACK 12288
+#define RENDER_TASK_PRIORITY 1
+#define RENDER_QUEUE_DEPTH 4                   // Power of two
+#define RENDER_MAX_DEPARTURES 3                // Cards on screen
+
 // ----------------------------------------------------------------------------
 // DATA REFRESH CONFIGURATION
 // ----------------------------------------------------------------------------
@@ -104,6 +182,13 @@
 #define BUS_DATA_REFRESH_SLOW_MS 600000        // Slow refresh every 10 minutes
 #define ACTIVE_HOURS_START 6                    // 6 AM - screen wakes
 #define ACTIVE_HOURS_END 23                     // 11 PM - screen sleeps
+// Service-aware hours: within ACTIVE_HOURS_START/END, the screen is awake from
+// the first departure seen (less the longest walk) to the last one, learned
+// per day type (weekday, Saturday, Sunday). Fixed hours until a type is learned.
+#define SERVICE_HOURS_ENABLED true
+#define SERVICE_HOURS_LEAD_MIN 10               // Awake this long before you'd set off for the first bus
+#define SERVICE_HOURS_SHRINK_MIN 15             // Most an edge moves inwards per day (outwards is immediate)
+#define SERVICE_HOURS_MIN_SIGHTINGS 6           // Days with fewer sightings teach nothing
 #define TRANSPORT_API_DAILY_LIMIT 300           // Max API calls allowed per day (Transport API)
 // Unified API daily limit - selects based on which API is active
 #if USE_NEXTBUS_API
@@ -112,13 +197,48 @@
 #define API_DAILY_LIMIT TRANSPORT_API_DAILY_LIMIT
 #endif
 
+// ----------------------------------------------------------------------------
+// DIRECTION PROFILES
+// The direction follows the time of day instead of toggle_direction. Each
+// profile runs from its start until the next one starts:
+//   { name, start minute of day, direction, stops (bit i = i-th stop of that
+//     direction), refresh weight (interval multiplier), daily budget share }
+// Shares should add up to 1. Budget a profile leaves unspent carries over to
+// the next. toggle_direction still works and holds until the next profile.
+// ----------------------------------------------------------------------------
+#define DIRECTION_PROFILES_ENABLED true
+#define DIRECTION_PROFILES \
+    {"to Cheltenham", 0,       TO_CHELTENHAM, 0x07, 1.0f, 0.55f}, \
+    {"to Churchdown", 14 * 60, TO_CHURCHDOWN, 0x03, 1.0f, 0.45f}
+
+// Volatility: stretch the interval while fetches come back unchanged,
+// shorten it while live times move. The budget planner rebalances the rest
+// of the day either way.
+#define VOLATILITY_SNAPSHOT_SIZE 12             // Departures compared per direction
+#define VOLATILITY_MAX_STOPS 4                  // Stops scored per direction
+#define VOLATILITY_SHIFT_MINUTES 1              // Smallest time move that counts as a change
+#define VOLATILITY_SMOOTHING 0.3f               // Weight of the newest fetch in a stop's score
+#define VOLATILITY_HIGH_SCORE 0.5f              // Score at which the interval is shortest
+#define VOLATILITY_MIN_SCALE 0.6f               // Shortest interval, as a share of the planned one
+#define VOLATILITY_MAX_BACKOFF 4                // Longest interval after repeated identical fetches
+#define VOLATILITY_MIN_INTERVAL_MS 180000       // Never fetch more often than this
+#define VOLATILITY_MAX_INTERVAL_MS 3600000      // Backoff never stretches past the planner's longest interval
+
 // ----------------------------------------------------------------------------
 // BATTERY MONITORING
 // ----------------------------------------------------------------------------
 #define BATTERY_PIN 14                          // ADC pin for battery voltage (ESP32-S3)
 #define BATTERY_VOLTAGE_FULL 4.0               // Full battery voltage
 #define BATTERY_VOLTAGE_EMPTY 3.3              // Empty battery voltage
-#define BATTERY_READ_INTERVAL_MS 60000         // Read battery every minute
+#define BATTERY_READ_INTERVAL_MS 60000         // Publish/log battery every minute
+#define BATTERY_SAMPLE_INTERVAL_MS 5000        // One filtered ADC sample every 5 s
+#define BATTERY_TREND_INTERVAL_MS 600000       // Discharge trend point every 10 minutes
+#define BATTERY_TREND_POINTS 12                // 2 hour trend window
+
+// Power profiles (see power_policy.cpp for the per-profile settings)
+#define POWER_MAINS_VOLTAGE 4.1                // At or above this we're on USB / charging
+#define POWER_SAVER_ENTER_PERCENT 30
+#define POWER_SAVER_EXIT_PERCENT 40
 
 // ADC calibration (adjust based on your voltage divider)
 #define BATTERY_ADC_REFERENCE 3.3
@@ -130,13 +250,51 @@
 #define OTA_GITHUB_USER "Dreadmond"
 #define OTA_GITHUB_REPO "Lilygo-T5-Bus-Timetable-Display"
 #define OTA_CHECK_INTERVAL_MS 3600000          // Check for updates every hour
+#define OTA_GITHUB_API_HOST "api.github.com"
+#define OTA_GITHUB_GZIP true                   // Ask for gzip-compressed release JSON
+
+// ----------------------------------------------------------------------------
+// GZIP RESPONSE DECODING
+// Only advertised to providers with a *_GZIP flag above. Nextbus isn't one:
+// its SIRI responses aren't known to honour Accept-Encoding.
+// ----------------------------------------------------------------------------
+#define GZIP_ARENA_BYTES (44 * 1024)           // Inflate state + 32 KB window, allocated once
+#define GZIP_CHUNK_BYTES 512                   // Inflated output per step
+
+// ----------------------------------------------------------------------------
+// MEMORY PLACEMENT
+// ----------------------------------------------------------------------------
+#define MEM_EXTMEM_THRESHOLD 2048              // Anonymous mallocs this size and up go to PSRAM
+
+// ----------------------------------------------------------------------------
+// FETCH CYCLE MEMORY
+// Response bodies and parse documents come from one block reset after each
+// fetch cycle, instead of from the internal heap
+// ----------------------------------------------------------------------------
+#define CYCLE_ARENA_BYTES (128 * 1024)         // PSRAM block
+#define CYCLE_ARENA_FALLBACK_BYTES (32 * 1024) // Internal heap block when there's no PSRAM
 
 // ----------------------------------------------------------------------------
-// WEATHER API CONFIGURATION (Optional - not currently used)
+// WEATHER API CONFIGURATION (Optional - only fetched when a key is set)
 // ----------------------------------------------------------------------------
 #define WEATHER_API_KEY ""
 #define WEATHER_LAT_STR ""
 #define WEATHER_LON_STR ""
+#define WEATHER_API_HOST "api.openweathermap.org"
+#define WEATHER_UPDATE_INTERVAL_MS 1800000     // Every 30 minutes
+#define WEATHER_CACHE_TTL_MS 7200000           // Hide the header reading after 2 hours
+
+// ----------------------------------------------------------------------------
+// NETWORK WINDOWS
+// Periodic network jobs are batched into one radio-on window. Each job may
+// wait up to its max delay past its interval for the next bus fetch.
+// ----------------------------------------------------------------------------
+#define NETWIN_MAX_JOBS 6
+#define NETWIN_BUDGET_MS 20000                 // Later low-priority jobs defer past this
+#define NETWIN_EARLY_PERCENT 25                // Jobs this close to due ride along early
+#define NETWIN_TELEMETRY_MAX_DELAY_MS 600000   // MQTT state may lag up to 10 minutes
+#define NETWIN_OTA_MAX_DELAY_MS 1800000
+#define NETWIN_WEATHER_MAX_DELAY_MS 900000
 
 // ----------------------------------------------------------------------------
 // DEEP SLEEP CONFIGURATION
@@ -144,6 +302,65 @@
 #define ENABLE_DEEP_SLEEP false                 // Set to true for battery operation
 #define DEEP_SLEEP_DURATION_US 60000000        // 60 seconds in microseconds
 
+// ----------------------------------------------------------------------------
+// NETWORK LOG STREAMING
+// Batched syslog over UDP to a LAN collector (run netlog_receiver.py there)
+// Records are only sent right after a fetch, while the radio is already on
+// ----------------------------------------------------------------------------
+#define NETLOG_ENABLED false                    // Set to true for wall-mounted units
+#define NETLOG_HOST "192.168.1.10"              // Collector IP on the LAN
+#define NETLOG_PORT 5514
+#define NETLOG_BUFFER_RECORDS 32                // Records held between radio-on windows
+#define NETLOG_MAX_MESSAGE 120                  // Characters per record
+#define NETLOG_MAX_RECORDS_PER_MIN 60           // Rate limit
+#define NETLOG_SLOW_FETCH_MS 20000              // Fetch cycles slower than this are logged as warnings
+
+// ----------------------------------------------------------------------------
+// DNS CACHE (API, OTA and MQTT hosts, kept in RTC memory across sleep)
+// The Arduino resolver doesn't expose record TTLs, so a fixed TTL is used
+// ----------------------------------------------------------------------------
+#define DNS_CACHE_SIZE 6
+#define DNS_CACHE_TTL_S 3600                    // Treat addresses as valid for an hour
+#define DNS_REFRESH_AHEAD_S 600                 // Start a background refresh this long before expiry
+#define DNS_RETRY_S 60                          // Minimum gap between lookups of one host
+#define DNS_REFRESH_JOB_MS 300000               // Refresh job checks for entries near expiry this often
+
+// ----------------------------------------------------------------------------
+// DELAY MODEL (learned lateness per route, stop and hour, kept in RTC memory)
+// ----------------------------------------------------------------------------
+#define DELAY_MODEL_SLOTS 96                    // Route/stop/hour slots (8 bytes each)
+#define DELAY_MODEL_BUCKET_MINUTES 60           // Time-of-day bucket width
+#define DELAY_MODEL_MIN_SAMPLES 3               // Live observations before a slot is trusted
+#define DELAY_MODEL_WEIGHT_SHIFT 3              // Averaging weight 1/8 once a slot is trained
+#define DELAY_MODEL_MAX_MINUTES 45              // Larger gaps are treated as bad data
+
+// ----------------------------------------------------------------------------
+// PUNCTUALITY STATS (per route and stop, published to Home Assistant)
+// ----------------------------------------------------------------------------
+#define PUNCTUALITY_SLOTS 10                    // Route/stop pairs tracked (~200 bytes each, RTC memory)
+#define PUNCTUALITY_EARLY_MINUTES 1             // "On time" window, as used for UK bus punctuality
+#define PUNCTUALITY_LATE_MINUTES 5
+#define PUNCTUALITY_MIN_SAMPLES 5               // Buses counted before a pair is published
+#define PUNCTUALITY_PUBLISH_DELTA_MIN 0.5       // Republish when a delay figure moves this much
+#define PUNCTUALITY_PUBLISH_DELTA_PCT 2.0       // ...or the on-time share moves this many points
+#define MQTT_PUNCTUALITY_TOPIC "bus_timetable/punctuality"
+
+// ----------------------------------------------------------------------------
+// HISTORY LOG (departure observations on LittleFS in the spiffs partition)
+// Query with GET /api/history?day=YYYY-MM-DD&route=94 on the OTA web server
+// ----------------------------------------------------------------------------
+#define HISTORY_LOG_ENABLED true
+#define HISTORY_DIR "/history"
+#define HISTORY_SEGMENT_RECORDS 2048            // 32-byte records, 64 KB per segment file
+#define HISTORY_MAX_SEGMENTS 24                 // ~1.5 MB, fits the 1.9 MB partition
+#define HISTORY_BATCH_RECORDS 48                // Held in RAM until the end of the fetch cycle
+#define HISTORY_QUERY_CHUNK_BYTES 1024          // CSV sent per chunk
+
+// ----------------------------------------------------------------------------
+// BLACK BOX (RTC memory ring of recent fetch cycles, survives watchdog resets)
+// ----------------------------------------------------------------------------
+#define BLACKBOX_RECORDS 16                     // Cycles kept (~40 bytes each)
+
 // ----------------------------------------------------------------------------
 // DEBUG CONFIGURATION
 // ----------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+
+// ============================================================================
+// CONNECTIVITY MANAGER
+// Tracks the WiFi link from driver events rather than polling, reconnects in
+// the background with exponential backoff, and keeps MQTT connected while the
+// link is up. The scheduler asks isOnline() before starting any network work,
+// so a dead link costs nothing instead of a full HTTP timeout.
+// ============================================================================
+
+enum LinkState : uint8_t {
+    LINK_DOWN,          // Waiting for the next reconnect attempt
+    LINK_CONNECTING,    // Association started, waiting for an IP
+    LINK_UP             // Associated and addressed
+};
+
+class ConnectivityManager {
+public:
+    ConnectivityManager();
+
+    // Take over an established connection (call after setupWiFi succeeds)
+    void begin(const String& ssid, const String& password);
+
+    // Drive reconnects and MQTT - never blocks on the network
+    void loop();
+
+    // Readiness signals for the scheduler
+    bool isOnline() const;
+    bool isMqttReady();
+
+    LinkState getState() const;
+    unsigned long getDisconnectCount() const;
+
+private:
+    String ssid;
+    String password;
+    bool started;
+    LinkState state;
+
+    // Set from the WiFi event task, consumed in loop()
+    volatile bool gotIpEvent;
+    volatile bool lostLinkEvent;
+    volatile uint8_t lastDisconnectReason;
+
+    unsigned long attemptStart;
+    unsigned long nextAttempt;
+    unsigned long backoffMs;
+    unsigned long linkLostAt;
+    unsigned long disconnectCount;
+    bool attemptFast;           // Current attempt used the cached BSSID/channel
+    bool nextAttemptFast;
+
+    void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void startAttempt(unsigned long now);
+    void attemptFailed(unsigned long now);
+};
+
+extern ConnectivityManager connectivity;
+
+#endif // CONNECTIVITY_H
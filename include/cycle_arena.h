@@ -0,0 +1,60 @@
+#ifndef CYCLE_ARENA_H
+#define CYCLE_ARENA_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================================================
+// CYCLE ARENA
+// Bump allocator for everything a fetch cycle throws away: response bodies,
+// JSON documents and parser scratch. One block is taken at boot (PSRAM when
+// present) and handed out front to back, each block behind a small size
+// header; nothing is freed individually.
+// mark()/rewind() drop one stop's data, reset() ends the cycle - both O(1) -
+// so the internal heap never sees the churn and its largest block holds.
+// ============================================================================
+
+class CycleArena : public ArduinoJson::Allocator {
+public:
+    CycleArena();
+
+    // Take the block (call once in setup)
+    bool begin();
+
+    // Raw memory, 8-byte aligned. nullptr when the arena is full.
+    void* alloc(size_t size);
+
+    // NUL-terminated copy of len bytes
+    char* copy(const char* src, size_t len);
+
+    // Read a whole HTTP body (chunked or not) into the arena, NUL-terminated.
+    // Returns nullptr if it failed or didn't fit.
+    char* readBody(HTTPClient& http, size_t& length);
+
+    size_t mark() const { return used; }
+    void rewind(size_t markPos);
+    void reset();
+
+    size_t getCapacity() const { return capacity; }
+    size_t getHighWater() const { return highWater; }
+
+    // ArduinoJson::Allocator - lets a JsonDocument live in the arena
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    size_t highWater;
+    uint8_t* last;          // Newest block - the only one that can grow in place
+
+    friend class ArenaBodySink;
+};
+
+extern CycleArena cycleArena;
+
+#endif // CYCLE_ARENA_H
@@ -0,0 +1,47 @@
+#ifndef DELAY_MODEL_H
+#define DELAY_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// DELAY MODEL
+// Learns how late each route runs at each stop, per hour of the day and
+// split weekday/weekend, from the Expected vs Aimed times of live buses.
+// Scheduled-only departures are shifted by the learned delay, and so is
+// every bus once the last fetch is more than a fetch interval old, so the
+// countdowns stay close to reality while the planner skips fetches. The
+// table is a fixed array in RTC memory and survives deep sleep; when it is
+// full the least-trained slot is recycled.
+// ============================================================================
+
+class DelayModel {
+public:
+    DelayModel();
+
+    // Validate the RTC table (call once at boot)
+    void init();
+
+    // A live bus aimed at aimedMinuteOfDay is running delayMinutes late.
+    // Minutes count from today's midnight, so yesterday is negative and
+    // tomorrow is 1440 and up - the weekend split follows that day.
+    void observe(const char* route, const char* stop, int aimedMinuteOfDay, int delayMinutes);
+
+    // Learned delay for a scheduled bus, false until the slot has enough samples
+    bool estimate(const char* route, const char* stop, int aimedMinuteOfDay, int& delayMinutes) const;
+
+    int getTrainedSlots() const;
+    int getObservations() const { return observations; }
+    int getEstimates() const { return estimates; }
+
+private:
+    int observations;           // Since boot
+    mutable int estimates;
+
+    static uint32_t keyFor(const char* route, const char* stop, int aimedMinuteOfDay);
+    int findSlot(uint32_t key) const;
+};
+
+extern DelayModel delayModel;
+
+#endif // DELAY_MODEL_H
@@ -0,0 +1,65 @@
+#ifndef DIRECTION_PROFILES_H
+#define DIRECTION_PROFILES_H
+
+#include <Arduino.h>
+#include "config.h"
+#if USE_NEXTBUS_API
+#include "nextbus_api.h"
+#else
+#include "transport_api.h"
+#endif
+
+// ============================================================================
+// DIRECTION PROFILES
+// Picks the direction, the stops to fetch and the budget for each part of
+// the day from DIRECTION_PROFILES, so no calls go to the direction nobody
+// needs at that hour. The budget planner asks for the calls and time the
+// current profile has left rather than the whole day's.
+// ============================================================================
+
+struct DirectionProfile {
+    const char* name;
+    int startMinute;            // Minute of day the profile takes over
+    Direction direction;
+    uint8_t stopMask;           // Bit i = i-th stop of the direction
+    float refreshWeight;        // Multiplies the planned interval
+    float budgetShare;          // Share of API_DAILY_LIMIT
+};
+
+class DirectionScheduler {
+public:
+    DirectionScheduler();
+
+    // Follow the clock; true when a different profile has taken over
+    bool update(int minuteOfDay);
+
+    // Current profile, nullptr until the clock is valid
+    const DirectionProfile* current() const;
+
+    // Manual direction change - holds until the next profile starts
+    void overrideDirection();
+    bool isOverridden() const { return overridden; }
+
+    // Calls the current profile may still make, given today's total so far
+    int remainingCalls(int apiCallsToday) const;
+
+    // Minutes until the current profile ends (or active hours do)
+    int minutesLeft(int minuteOfDay) const;
+
+    // API calls one refresh costs under the current profile
+    int stopsPerRefresh(int directionStopCount) const;
+
+    // Stops a profile for this direction fetches (all if none covers it)
+    uint8_t stopMaskFor(Direction dir) const;
+
+private:
+    int currentIndex;
+    bool overridden;
+
+    static const DirectionProfile profiles[];
+    static const int profileCount;
+};
+
+extern DirectionScheduler directionSchedule;
+
+#endif // DIRECTION_PROFILES_H
@@ -25,6 +25,8 @@ struct BusDeparture {
     int walkingTimeMinutes;
     bool isLive;
     String statusText;
+    String stopCode;            // ATCO code, for the delay model (NextBus only)
+    uint32_t aimedAt = 0;       // Scheduled departure epoch, 0 = unknown
 };
 
 // Screen regions for partial updates
@@ -62,6 +64,15 @@ public:
     void fullRefresh();                     // Complete screen refresh (clears ghosting)
     void partialRefresh(ScreenRegion region); // Update specific region only
     void fastRefresh();                     // Quick update (for countdown timers)
+    void setClearCycles(int cycles);        // Clear passes before a timetable redraw (power policy)
+    void setWeather(const char* label);     // Hero header weather ("" hides it), redraws only the header
+
+    // Update transactions: regions pushed between beginUpdate() and
+    // commitUpdate() share one panel power-up and go out top to bottom.
+    // Outside a transaction every push commits on its own. Nests.
+    void beginUpdate();
+    void queueRegion(ScreenRegion region, UpdateMode mode);
+    void commitUpdate();
     
     // Main display functions
     void showBusTimetable(BusDeparture departures[], int count, 
@@ -113,9 +124,13 @@ private:
     bool loadingLogActive;
     int loadingLogCursorY;
     bool colorsInverted;
+    int clearCycles;
+    bool timetableOnScreen;                 // Header-only updates are safe
+    char weatherLabel[24];
     
     // Cached values for partial updates
     String lastTimeStr;
+    String lastDirection;
     int lastBatteryPercent;
     static const int MAX_TRACKED_DEPARTURES = 3;
     int lastLeaveIn[MAX_TRACKED_DEPARTURES];
@@ -167,6 +182,22 @@ private:
     
     // Update region to EPD
     void pushRegionToDisplay(ScreenRegion region, UpdateMode mode);
+
+    // Pending update transaction. Regions widen to full-width row bands so
+    // each one is a contiguous slice of the framebuffer.
+    static const int CLEAR_NONE = 0;
+    static const int CLEAR_DEFAULT = -1;    // epd_clear_area(), otherwise a cycle count
+    struct PendingBand {
+        int top;
+        int bottom;                         // Exclusive
+        int clearCycles;
+        bool draw;
+    };
+    PendingBand pending[DISPLAY_MAX_PENDING_AREAS];
+    int pendingCount;
+    int updateDepth;
+    void pushArea(Rect_t area, int clearCycles, bool draw = true);
+    void mergeBand(PendingBand& into, const PendingBand& band);
     
     Rect_t clampToScreen(Rect_t rect) const;
 };
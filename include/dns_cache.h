@@ -0,0 +1,60 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include "config.h"
+
+// ============================================================================
+// DNS CACHE
+// Keeps resolved addresses for the API, OTA and MQTT hosts in RTC memory so
+// they survive light and deep sleep. Entries are refreshed with asynchronous
+// lookups before they expire - started from a network window job, so they
+// share the radio-on time with the fetches - and a fetch connects straight
+// to a known address instead of waiting on the resolver. A stale entry is still served
+// while its refresh is in flight; a failed connect drops it.
+// ============================================================================
+
+class DnsCache {
+public:
+    DnsCache();
+
+    // Validate the RTC table and register the hosts we talk to
+    void init();
+
+    // Collect finished background lookups (call from loop - no network traffic)
+    void loop();
+
+    // Start background lookups for entries near expiry (network window job)
+    void refresh();
+
+    // Cached address for host; blocks on the resolver only on a miss
+    bool resolve(const char* host, IPAddress& ip);
+
+    // Cached address for host only - never touches the resolver
+    bool lookup(const char* host, IPAddress& ip);
+
+    // Forget the address for host (e.g. after a failed connect)
+    void invalidate(const char* host);
+
+    // Open client to host:port using the cached address. HTTPClient reuses
+    // an already-connected client, so call this right before http.begin()
+    bool connect(WiFiClient& client, const char* host, uint16_t port);
+    bool connect(WiFiClientSecure& client, const char* host, uint16_t port);
+
+    int getHitCount() const;
+    int getMissCount() const;
+
+private:
+    int hits;
+    int misses;
+
+    int findEntry(const char* host) const;
+    int addEntry(const char* host);
+    void store(int index, uint32_t ip);
+};
+
+extern DnsCache dnsCache;
+
+#endif // DNS_CACHE_H
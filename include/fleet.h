@@ -0,0 +1,108 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <Arduino.h>
+#include "config.h"
+#if USE_NEXTBUS_API
+#include "nextbus_api.h"
+#else
+#include "transport_api.h"
+#endif
+
+// ============================================================================
+// FLEET MODE
+// Several displays in one building share a single API budget over the MQTT
+// broker. One device holds a lease on a retained leader topic, fetches for
+// every direction the fleet is showing and publishes retained snapshots.
+// Followers render those snapshots and never make HTTP calls; when the
+// leader stops renewing, the lease runs out and a follower takes over. A
+// leader whose own screen goes to the clock (nobody home, outside its
+// service hours) releases the lease so an active display takes over.
+// ============================================================================
+
+enum FleetRole : uint8_t {
+    FLEET_SOLO,         // Fleet mode off, or no broker - fetch locally
+    FLEET_CANDIDATE,    // Joined, waiting to hear from a leader
+    FLEET_LEADER,
+    FLEET_FOLLOWER
+};
+
+class FleetCoordinator {
+public:
+    FleetCoordinator();
+
+    // Subscribe to the fleet topics (call after mqtt.init())
+    void begin(const String& deviceId);
+
+    // Election and lease upkeep - call every loop. active = this display is
+    // showing buses; an inactive one never claims and a leader steps down.
+    void loop(bool mqttReady, Direction wantedDirection, bool active);
+
+    bool isLeader() const;
+    bool isFollower() const;    // Skip all fetching while true
+    // False while a follower, or while the election is still settling -
+    // a booting display doesn't know yet whether another one fetches
+    bool mayFetch() const;
+    FleetRole getRole() const;
+    const char* getRoleName() const;
+
+    // Leader: has a follower asked for this direction recently?
+    bool isDirectionWanted(Direction dir) const;
+
+    // Leader: publish a fetched list as the retained snapshot for its direction
+    void publishSnapshot(Direction dir, const BusDeparture* departures, int count);
+
+    // Follower: a snapshot arrived that hasn't been copied out yet
+    bool hasNewSnapshot(Direction dir) const;
+
+    // Copy the latest snapshot, countdowns aged to now. Returns -1 if none.
+    int copySnapshot(Direction dir, BusDeparture* out, int maxCount);
+
+    // Weather header label: set by the leader, carried in its snapshots so
+    // followers need no HTTP of their own. "" until one has arrived.
+    void shareWeather(const char* label);
+    const char* getWeather() const { return weather; }
+
+    // MQTT message hook for the fleet topics
+    static void onMessage(const char* topic, const uint8_t* payload, unsigned int length);
+
+private:
+    struct Snapshot {
+        BusDeparture departures[FLEET_MAX_DEPARTURES];
+        int count;
+        uint32_t epoch;             // Leader's clock at fetch (0 if unknown)
+        unsigned long receivedAt;
+        bool valid;
+        bool fresh;                 // Not yet copied out
+    };
+
+    bool enabled;
+    String deviceId;
+    FleetRole role;
+    bool mqttReady;
+    String leaderId;
+    unsigned long joinedAt;
+    unsigned long lastLeaderSeen;
+    unsigned long lastClaim;
+    unsigned long lastWant;
+    unsigned long stagger;          // Per-device offset so claims don't collide
+    int lastWantDirection;
+    bool reassertClaim;             // Set from the MQTT callback, acted on in loop()
+    unsigned long wantSeen[2];      // Leader: when a follower last asked per direction
+    Snapshot snapshots[2];
+    char weather[24];
+
+    void claim(unsigned long now);
+    void release();
+    void publishWant(Direction dir, unsigned long now);
+    void setRole(FleetRole newRole, const char* reason);
+    void handleLeader(const uint8_t* payload, unsigned int length);
+    void handleWant(const uint8_t* payload, unsigned int length);
+    void handleSnapshot(int dir, const uint8_t* payload, unsigned int length);
+
+    static const char* directionKey(Direction dir);
+};
+
+extern FleetCoordinator fleet;
+
+#endif // FLEET_H
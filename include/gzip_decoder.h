@@ -0,0 +1,56 @@
+#ifndef GZIP_DECODER_H
+#define GZIP_DECODER_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include "config.h"
+#include "zlib/zlib.h"
+
+// ============================================================================
+// GZIP RESPONSE DECODER
+// Inflates a gzip or deflate (zlib-wrapped or raw) encoded HTTP body while
+// it streams off the socket, using the zlib that ships with the display driver. The body goes
+// through HTTPClient::writeToStream(), so chunked transfer and keep-alive
+// still work. zlib's state and window live in one block allocated on first
+// use and reused for every response.
+// ============================================================================
+
+class GzipDecoder : public Stream {
+public:
+    GzipDecoder();
+
+    // Advertise gzip and keep the Content-Encoding header. Call after
+    // clockService.watchDateHeader() - Date stays in the collected list.
+    static void accept(HTTPClient& http);
+
+    // Read the whole body into out, inflating it if the server compressed it.
+    // Returns false on a transfer or inflate error.
+    bool readBody(HTTPClient& http, String& out);
+
+    // Stream sink for writeToStream()
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+private:
+    z_stream zs;
+    String* target;
+    bool failed;
+    bool finished;
+    bool started;           // inflateInit2() done (deflate defers it to the first bytes)
+    uint8_t held;           // First byte of a deflate body that arrived alone
+    size_t heldLen;
+
+    bool start(int windowBits);
+    bool inflateInput(const uint8_t* data, size_t len);
+
+    // zlib allocation hooks backed by the fixed arena
+    static void* arenaAlloc(void* opaque, uInt items, uInt size);
+    static void arenaFree(void* opaque, void* ptr);
+};
+
+extern GzipDecoder gzipDecoder;
+
+#endif // GZIP_DECODER_H
@@ -0,0 +1,76 @@
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "config.h"
+
+// ============================================================================
+// DEPARTURE HISTORY LOG
+// Append-only record of every departure the parser sees (route, stop, aimed,
+// expected, observed-at), kept on LittleFS in the otherwise unused spiffs
+// partition. Records are fixed-width and are appended once per fetch cycle.
+// The log is split into segment files: when the partition fills up, the
+// oldest segment is deleted whole, so nothing is ever rewritten in place.
+// A small index of aimed-time range and routes per segment lets a query
+// skip segments without opening them. Results stream out in chunks, so a
+// query never holds the log in RAM.
+// ============================================================================
+
+struct HistoryRecord {
+    uint32_t observedAt;    // Epoch of the fetch
+    uint32_t aimedAt;       // Timetabled departure (epoch)
+    uint32_t expectedAt;    // Real-time estimate (epoch), 0 = scheduled only
+    char route[8];
+    char stop[12];          // ATCO code, not terminated when 12 characters long
+};
+
+class HistoryLog {
+public:
+    HistoryLog();
+
+    // Mount the filesystem and load the segment index
+    bool begin();
+    bool isReady() const { return mounted; }
+
+    // Queue one observation for the next flush
+    void add(const char* route, const char* stop, uint32_t aimedAt, uint32_t expectedAt);
+
+    // Append queued records (call once per fetch cycle)
+    void flush();
+
+    // GET /api/history?day=YYYY-MM-DD[&route=94] - CSV, chunked
+    void streamQuery(WebServer& server);
+
+    uint32_t getRecordCount() const;
+    int getSegmentCount() const { return segmentCount; }
+
+private:
+    struct SegmentInfo {
+        uint32_t seq;
+        uint32_t count;
+        uint32_t firstAimed;    // Lowest aimed time in the segment
+        uint32_t lastAimed;     // Highest aimed time in the segment
+        uint32_t routeMask;     // One bit per route hash
+    };
+
+    bool mounted;
+    SegmentInfo segments[HISTORY_MAX_SEGMENTS];
+    int segmentCount;           // Oldest first; the last one is open for appends
+    HistoryRecord pending[HISTORY_BATCH_RECORDS];
+    int pendingCount;
+    int dropped;
+
+    static uint32_t routeBit(const char* route);
+    static void segmentPath(uint32_t seq, char* path, size_t size);
+    static void noteRecord(SegmentInfo& info, const HistoryRecord& record);
+
+    bool scanSegment(SegmentInfo& info);
+    bool saveIndex();
+    bool openSegment();
+    bool parseDay(const String& value, uint32_t& dayStart, uint32_t& dayEnd) const;
+};
+
+extern HistoryLog historyLog;
+
+#endif // HISTORY_LOG_H
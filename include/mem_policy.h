@@ -0,0 +1,61 @@
+#ifndef MEM_POLICY_H
+#define MEM_POLICY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "config.h"
+
+// ============================================================================
+// MEMORY PLACEMENT POLICY
+// Internal RAM is shared with WiFi, lwIP and TLS, which fail when it runs
+// short, while the 8 MB of PSRAM sat idle apart from the framebuffer. Every
+// buffer of ours now says what it is: large and rarely touched goes to PSRAM,
+// hot or DMA-visible stays internal. Anonymous mallocs above
+// MEM_EXTMEM_THRESHOLD (String growth, library buffers) go to PSRAM as well.
+// ============================================================================
+
+enum MemPlacement : uint8_t {
+    MEM_BULK,       // Large, touched now and then - PSRAM, internal if there is none
+    MEM_HOT,        // Touched in tight loops - internal
+    MEM_DMA,        // Read by a peripheral - internal and DMA capable
+    MEM_PLACEMENT_COUNT
+};
+
+class MemoryPolicy {
+public:
+    MemoryPolicy();
+
+    // Route large anonymous mallocs to PSRAM (call first thing in setup)
+    void begin();
+
+    bool hasPsram() const { return psramAvailable; }
+
+    void* allocate(size_t size, MemPlacement where);
+    void* reallocate(void* ptr, size_t size, MemPlacement where);
+    void release(void* ptr);
+
+    // ArduinoJson allocator for documents with the given placement
+    ArduinoJson::Allocator* json(MemPlacement where);
+
+    // One-line per-pool usage: free, largest block and low-water mark for
+    // internal RAM and PSRAM, plus what the policy placed and any fallbacks
+    void formatUsage(char* out, size_t outSize) const;
+
+private:
+    // Bumped from both cores (network task and render task)
+    struct PlacementStats {
+        std::atomic<uint32_t> allocations;
+        std::atomic<uint32_t> fallbacks;    // Wanted PSRAM, got internal
+        std::atomic<uint32_t> failures;
+    };
+
+    bool psramAvailable;
+    PlacementStats stats[MEM_PLACEMENT_COUNT];
+
+    static uint32_t capsFor(MemPlacement where);
+};
+
+extern MemoryPolicy memPolicy;
+
+#endif // MEM_POLICY_H
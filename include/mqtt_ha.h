@@ -5,6 +5,7 @@
 #include <PubSubClient.h>
 #include <WiFiClient.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "config.h"
 
 // ============================================================================
@@ -16,12 +17,16 @@ class MQTTHomeAssistant {
 public:
     MQTTHomeAssistant();
     
-    // Initialize and connect
+    // Initialize and connect. connect() blocks for up to MQTT_SOCKET_TIMEOUT_S
+    // and is meant for setup; loop() reconnects without blocking.
     void init();
     bool connect();
     void loop();
     bool isConnected();
     
+    // Skip the reconnect backoff (e.g. the WiFi link just came back)
+    void retryNow();
+    
     // Publish Home Assistant discovery configs
     void publishDiscoveryConfig();
     
@@ -29,7 +34,18 @@ public:
     void publishState(int batteryPercent, float batteryVoltage, 
                       int rssi, const String& direction,
                       int busCount, const String& ipAddress,
-                      const String& version, int apiCallsToday);
+                      const String& version, int apiCallsToday,
+                      float batteryHoursLeft = -1,
+                      const char* powerMode = nullptr);
+    
+    // Publish an arbitrary payload (streams payloads larger than the buffer)
+    bool publish(const char* topic, const String& payload, bool retained = false);
+    
+    // Sensor discovery config; other modules pass their own state topic
+    void publishSensorDiscovery(const char* name, const char* uniqueId,
+                                const char* deviceClass, const char* unit,
+                                const char* valueTemplate, const char* icon,
+                                const char* stateTopic = MQTT_STATE_TOPIC);
     
     // Publish availability
     void publishAvailable();
@@ -37,23 +53,45 @@ public:
     
     // Handle incoming commands
     void setCommandCallback(void (*callback)(const String& command));
+    
+    // Extra topics (re)subscribed on every connect; their messages go to the
+    // callback given with the topic as raw bytes. A filter ending in "/#"
+    // matches everything below it.
+    typedef void (*MessageCallback)(const char* topic, const uint8_t* payload, unsigned int length);
+    void addSubscription(const char* topic, MessageCallback callback);
+    
+    // Unique device ID based on MAC
+    String getDeviceId();
 
 private:
     WiFiClient wifiClient;
     PubSubClient mqttClient;
     bool discoveryPublished;
     unsigned long lastReconnectAttempt;
+    unsigned long reconnectInterval;  // Backoff, doubles on each failure
+    
+    // Non-blocking reconnect: a helper task opens the TCP socket, loop()
+    // finishes the MQTT handshake once it is up
+    enum TcpState : uint8_t { TCP_IDLE, TCP_CONNECTING, TCP_READY, TCP_FAILED };
+    std::atomic<uint8_t> tcpState;
+    IPAddress brokerIp;               // Set before the helper task starts
+    bool brokerByIp;
     void (*commandCallback)(const String& command);
+    const char* extraTopics[MQTT_MAX_EXTRA_SUBSCRIPTIONS];
+    MessageCallback extraCallbacks[MQTT_MAX_EXTRA_SUBSCRIPTIONS];
+    int extraTopicCount;
     String lastPublishedVersion;  // Track last published version to detect updates
     
-    // Unique device ID based on MAC
-    String getDeviceId();
     String getMacAddress();
     
+    bool beginAttempt(bool mayBlock);
+    bool finishConnect();
+    void backOff();
+    void reconnectAsync();
+    bool clientConnected();
+    static void tcpConnectTask(void* arg);
+    
     // Discovery message builders
-    void publishSensorDiscovery(const char* name, const char* uniqueId,
-                                const char* deviceClass, const char* unit,
-                                const char* valueTemplate, const char* icon);
     void publishBinarySensorDiscovery(const char* name, const char* uniqueId,
                                       const char* deviceClass, const char* valueTemplate);
     void publishButtonDiscovery(const char* name, const char* uniqueId,
@@ -0,0 +1,68 @@
+#ifndef NET_LOG_H
+#define NET_LOG_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "config.h"
+
+// ============================================================================
+// NETWORK LOG SINK
+// Buffers log records in RAM and ships them as batched syslog datagrams to a
+// LAN collector. Wall-mounted units have no USB, so this replaces serial.
+// ============================================================================
+
+// Syslog severities (RFC 5424)
+enum NetLogLevel : uint8_t {
+    NETLOG_ERROR = 3,
+    NETLOG_WARNING = 4,
+    NETLOG_INFO = 6,
+    NETLOG_DEBUG = 7
+};
+
+class NetLogger {
+public:
+    NetLogger();
+
+    // Initialize (no socket is opened until the first flush)
+    void init();
+
+    // Queue a record - never touches the radio
+    void log(NetLogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+    // Send queued records in batched datagrams
+    // Call only from a planned radio-on window (e.g. right after a fetch)
+    // Returns the number of records sent
+    int flush();
+
+    int getPendingCount() const;
+    unsigned long getDroppedCount() const;
+
+private:
+    struct Record {
+        uint32_t uptimeMs;
+        uint32_t epoch;     // 0 if time was not yet valid
+        uint32_t seq;
+        uint8_t level;
+        char text[NETLOG_MAX_MESSAGE];
+    };
+
+    Record records[NETLOG_BUFFER_RECORDS];
+    int head;               // Index of oldest record
+    int count;
+    uint32_t nextSeq;
+    unsigned long dropped;          // Overwritten before they could be sent
+    unsigned long droppedReported;
+
+    // Rate limiting (records per minute)
+    unsigned long rateWindowStart;
+    int sentInWindow;
+
+    WiFiUDP udp;
+
+    // Format one record as an RFC 5424 line, returns length written
+    int formatRecord(const Record& rec, char* out, size_t outSize) const;
+};
+
+extern NetLogger netLog;
+
+#endif // NET_LOG_H
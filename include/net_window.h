@@ -0,0 +1,78 @@
+#ifndef NET_WINDOW_H
+#define NET_WINDOW_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// NETWORK WINDOW COORDINATOR
+// Lines up periodic network jobs (bus fetch, weather, OTA check, telemetry)
+// so they run back to back in one radio-on window instead of each waking the
+// radio on its own timer. Every job has a nominal interval and a maximum
+// delay: a window opens when some job hits its deadline, and every other job
+// that is due (or nearly due) rides along in priority order.
+// ============================================================================
+
+// Lower value runs first in a window
+enum NetJobPriority : uint8_t {
+    NETJOB_CRITICAL = 0,    // Always runs, even over the window budget
+    NETJOB_HIGH,
+    NETJOB_NORMAL,
+    NETJOB_LOW
+};
+
+class NetWindow {
+public:
+    NetWindow();
+
+    // Register a job, returns its id (-1 if the table is full)
+    // maxDelayMs is how long past its interval the job may wait for a window
+    int addJob(const char* name, void (*run)(), NetJobPriority priority,
+               unsigned long intervalMs, unsigned long maxDelayMs, bool needsMqtt = false);
+
+    // Intervals and enablement may change every loop (API budget, power profile)
+    void setInterval(int id, unsigned long intervalMs);
+    void setEnabled(int id, bool enabled);
+
+    // Run the job in the next window, opening one straight away
+    void trigger(int id);
+
+    // Record a run that happened outside a window (setup, MQTT commands)
+    void markRun(int id);
+
+    // Open a window if any job's deadline has passed - call every loop
+    void loop(bool online, bool mqttReady);
+
+    unsigned long getWindowCount() const;
+    int getWindowsLastHour() const;
+
+private:
+    struct Job {
+        const char* name;
+        void (*run)();
+        NetJobPriority priority;
+        unsigned long intervalMs;
+        unsigned long maxDelayMs;
+        unsigned long lastRun;
+        bool needsMqtt;
+        bool enabled;
+        bool triggered;
+    };
+
+    Job jobs[NETWIN_MAX_JOBS];
+    int jobCount;
+
+    unsigned long windowCount;
+    unsigned long hourStart;
+    int windowsThisHour;
+    int windowsLastHour;
+
+    bool isRunnable(const Job& job, bool mqttReady) const;
+    bool isDue(const Job& job, unsigned long now) const;
+    bool isPastDeadline(const Job& job, unsigned long now) const;
+    void runWindow(unsigned long now, bool mqttReady);
+};
+
+extern NetWindow netWindow;
+
+#endif // NET_WINDOW_H
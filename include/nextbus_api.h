@@ -37,6 +37,10 @@ public:
     // Switch direction
     void setDirection(Direction dir);
     Direction getDirection() const;
+    
+    // Stops to fetch, bit i = i-th stop of the direction (forced refetches take all)
+    void setStopMask(uint8_t mask);
+    uint8_t getStopMask() const { return stopMask; }
     String getDirectionLabel() const;
     
     // Get last error
@@ -56,6 +60,7 @@ private:
     String lastError;
     WiFiClient httpClient;  // HTTP (not HTTPS) for Traveline API
     int lastApiCallCount;  // Track API calls made in last fetch
+    uint8_t stopMask;
     int messageIdCounter;  // For SIRI-SM MessageIdentifier
     
     // Stop configurations (same as Transport API)
@@ -85,18 +90,18 @@ private:
     String getCurrentTimestamp();
     
     // Parse departure time from ISO 8601 format
-    void parseDepartureTime(const String& timeStr, const String& estimateStr,
+    void parseDepartureTime(const char* timeStr, const char* estimateStr,
                            String& displayTime, int& minutesUntil);
     
-    // Parse SIRI-SM XML response
-    bool parseSiriResponse(const String& xmlResponse, const BusStop& stop,
+    // Parse SIRI-SM XML response (body held in the cycle arena)
+    bool parseSiriResponse(const char* xml, size_t length, const BusStop& stop,
                           BusDeparture* departures, int& currentCount, int maxCount, int maxPerStop = 999);
     
     // Check if destination matches filter
-    bool isValidDestination(const String& destination, Direction dir);
+    bool isValidDestination(const char* destination, Direction dir);
     
     // Check if route is in target routes
-    bool isTargetRoute(const String& route);
+    bool isTargetRoute(const char* route);
     
     // Check if route actually stops at the given stop
     bool isValidRouteForStop(const String& route, const char* stopAtcocode);
@@ -5,6 +5,7 @@
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <Update.h>
+#include <WebServer.h>
 #include <ArduinoJson.h>
 #include "config.h"
 
@@ -38,6 +39,9 @@ public:
     int getUpdateProgress() const;
     bool isUpdating() const;
     
+    // Status web server, so other modules can register /api routes
+    WebServer& getWebServer();
+    
     // Set callback for update events
     void setProgressCallback(void (*callback)(int progress));
     void setCompleteCallback(void (*callback)(bool success));
@@ -0,0 +1,57 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// POWER POLICY
+// Picks a power profile from the battery monitor and hands the scheduler its
+// settings: fetch spacing, e-paper clearing, WiFi modem sleep, telemetry and
+// OTA cadence. On battery the fetch spacing stretches gradually as the
+// charge falls rather than switching all at once at the low-battery screen.
+// ============================================================================
+
+enum PowerMode : uint8_t {
+    POWER_MAINS,        // Charging / on USB - full freshness
+    POWER_BATTERY,      // Normal battery running
+    POWER_SAVER         // Low battery - stretch everything
+};
+
+struct PowerSettings {
+    PowerMode mode;
+    const char* name;
+    float fetchScale;                   // Multiplier on the API budget interval
+    unsigned long displayTickMs;        // Countdown redraw interval between fetches
+    uint8_t clearCycles;                // E-paper clear passes before a full redraw (at least 1)
+    bool modemSleep;                    // WiFi modem sleep between network work
+    unsigned long telemetryIntervalMs;  // MQTT state publish
+    unsigned long otaIntervalMs;        // GitHub release check
+};
+
+class PowerPolicy {
+public:
+    PowerPolicy();
+
+    // Pick the initial profile (call after batteryMonitor.init())
+    void init();
+
+    // Re-evaluate from the battery monitor, returns true if the mode changed
+    bool update();
+
+    const PowerSettings& settings() const;
+
+    // Stretch an interval computed from the API budget
+    unsigned long scaleFetchInterval(unsigned long baseMs) const;
+
+private:
+    PowerSettings current;
+    bool initialized;
+
+    PowerMode chooseMode() const;
+    void apply(PowerMode mode);
+};
+
+extern PowerPolicy powerPolicy;
+
+#endif // POWER_POLICY_H
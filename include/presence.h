@@ -0,0 +1,42 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// PRESENCE GATE
+// Follows an occupancy topic and a motion topic over MQTT. Until the first
+// occupancy message arrives the house counts as occupied, so a quiet broker
+// never blanks the display. Someone leaving takes effect after a grace
+// period; an arrival or motion takes effect at once.
+// ============================================================================
+
+class PresenceGate {
+public:
+    PresenceGate();
+
+    // Subscribe to the configured topics (no-op when none are set)
+    void begin();
+
+    bool isEnabled() const { return enabled; }
+
+    // Someone may be looking at the display
+    bool isPresent();
+
+private:
+    bool enabled;
+    bool occupancyKnown;
+    volatile bool occupied;
+    volatile unsigned long leftAt;      // millis() of the last "away"
+    volatile unsigned long motionAt;    // millis() of the last motion, 0 = none
+    bool wasPresent;
+
+    static bool isOnPayload(const uint8_t* payload, unsigned int length);
+    static void onOccupancy(const char* topic, const uint8_t* payload, unsigned int length);
+    static void onMotion(const char* topic, const uint8_t* payload, unsigned int length);
+};
+
+extern PresenceGate presence;
+
+#endif // PRESENCE_H
@@ -0,0 +1,64 @@
+#ifndef PUNCTUALITY_H
+#define PUNCTUALITY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// PUNCTUALITY STATISTICS
+// Running delay statistics per route and stop: mean, P50 and P90 (P-square
+// streaming estimators, five markers each) and the share of buses on time.
+// A bus is counted once, with the last delay seen before it left, so a bus
+// that shows up in several fetches doesn't weigh more than one seen once.
+// Only buses still due are observed, and the last few counted per stop are
+// remembered, so one lingering in the feed after it left isn't counted again.
+// Memory is fixed and kept in RTC memory, so it survives deep sleep but
+// starts over after a reset or power cycle. Published to Home Assistant as
+// sensors, only when a figure moves by a meaningful amount.
+// ============================================================================
+
+// P-square quantile estimator (Jain & Chlamtac) - constant memory
+struct P2Quantile {
+    float height[5];        // Marker heights
+    int32_t pos[5];         // Marker positions (0-based)
+    uint32_t count;
+
+    void add(float x, float p);
+    float value(float p) const;
+};
+
+class PunctualityStats {
+public:
+    PunctualityStats();
+
+    // Validate the RTC table (call once at boot)
+    void init();
+
+    // A live bus, counted once it has left
+    void observe(const char* route, const char* stop, const char* stopName,
+                 uint32_t aimedAt, uint32_t expectedAt, int delayMinutes);
+
+    // Count buses whose departure has passed (called from publish())
+    void settle();
+
+    // Discovery and state for routes that changed enough since last time
+    void publish();
+
+    int getTrackedCount() const;
+
+private:
+    struct LastPublished {
+        bool discovered;
+        float mean;
+        float p50;
+        float p90;
+        float onTime;
+    };
+    LastPublished published[PUNCTUALITY_SLOTS];
+
+    int findSlot(const char* route, const char* stop, bool create);
+};
+
+extern PunctualityStats punctuality;
+
+#endif // PUNCTUALITY_H
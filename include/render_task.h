@@ -0,0 +1,81 @@
+#ifndef RENDER_TASK_H
+#define RENDER_TASK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "display.h"
+#include "spsc_queue.h"
+
+// ============================================================================
+// RENDER TASK
+// Framebuffer composition and the EPD push run on their own task pinned to
+// core 1, fed through an SPSC queue by the network task on core 0. A fetch
+// posts its timetable and goes straight on to the rest of the network
+// window while the panel refreshes, so a fetch and a render overlap instead
+// of adding up. Before begin() every command is drawn inline.
+// ============================================================================
+
+enum RenderCommandType : uint8_t {
+    RENDER_TIMETABLE,
+    RENDER_CLOCK,
+    RENDER_WEATHER,
+    RENDER_INVERT,
+    RENDER_CLEAR_CYCLES
+};
+
+struct RenderCommand {
+    RenderCommandType type;
+    BusDeparture departures[RENDER_MAX_DEPARTURES];
+    int count;                  // Timetable: departures. Clear cycles: passes.
+    char timeStr[16];
+    char label[32];             // Direction label, or the weather label
+    int batteryPercent;
+    bool wifiConnected;
+    bool placeholder;
+    bool flag;                  // Timetable: full refresh. Invert: inverted.
+    bool fetchCycle;            // Timetable: report the draw time to the black box
+};
+
+class RenderTask {
+public:
+    RenderTask();
+
+    // Start the task - commands queue from here on
+    void begin();
+    bool isRunning() const { return handle != nullptr; }
+
+    void showTimetable(const BusDeparture* departures, int count,
+                       const String& currentTime, const String& direction,
+                       int batteryPercent, bool wifiConnected,
+                       bool placeholderMode, bool forceFullRefresh,
+                       bool fetchCycle = false);
+    void showClock(const String& timeStr);
+    void setWeather(const char* label);
+    void setInvertedColors(bool inverted);
+    void setClearCycles(int cycles);
+
+    // Block until everything queued is on the panel. Call before drawing
+    // with the display directly (OTA progress, low battery).
+    void waitIdle();
+
+    // Partial refreshes skipped because the queue was full
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    SpscQueue<RenderCommand, RENDER_QUEUE_DEPTH> queue;
+    TaskHandle_t handle;
+    std::atomic<bool> busy;
+    uint32_t dropped;
+    RenderCommand inlineCommand;    // Used before the task starts
+
+    RenderCommand* claim(bool mustDeliver);
+    void submit(RenderCommand* cmd);
+    void execute(RenderCommand& cmd);
+
+    static void taskMain(void* arg);
+};
+
+extern RenderTask renderTask;
+
+#endif // RENDER_TASK_H
@@ -0,0 +1,69 @@
+#ifndef SERVICE_HOURS_H
+#define SERVICE_HOURS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================================================
+// SERVICE HOURS
+// The active window follows the timetable instead of fixed hours: it opens
+// at the first departure of the day less the longest walk, and closes after
+// the last one. The API has no service span, so the span is learned from the
+// departures the parser sees, per day type (weekday, Saturday, Sunday), and
+// kept in NVS - one write per day at most. An edge moves out as soon as a
+// bus is seen beyond it and moves in only gradually, and only on days the
+// fetches actually covered that edge, so a day with patchy fetches can't cut
+// the window short. ACTIVE_HOURS_START/END stay the outer
+// bounds and the fallback until a day type has been learned.
+// ============================================================================
+
+enum ServiceDayType {
+    SERVICE_WEEKDAY = 0,
+    SERVICE_SATURDAY = 1,
+    SERVICE_SUNDAY = 2,
+    SERVICE_DAY_TYPES = 3
+};
+
+class ServiceHours {
+public:
+    ServiceHours();
+
+    // Load learned spans (call once at boot)
+    void begin();
+
+    // A departure of a configured route, aimed at this epoch
+    void observe(uint32_t aimedAt);
+
+    // A fetch succeeded now - marks how much of the day was looked at
+    void noteFetch();
+
+    // Now inside today's window (true while the clock is unknown)
+    bool isActive();
+
+    // Today's window in minutes of day, [start, end)
+    void today(int& startMinute, int& endMinute);
+
+    bool isLearned(ServiceDayType type) const { return learned[type].valid != 0; }
+
+    static ServiceDayType dayTypeOf(const struct tm& local);
+    static int32_t dateKeyOf(const struct tm& local);
+
+private:
+    struct Span {
+        int16_t first;          // Minute of day of the first departure
+        int16_t last;           // Minute of day of the last departure
+        uint8_t valid;
+    };
+    Span learned[SERVICE_DAY_TYPES];
+
+    static int longestWalk();
+
+    void window(ServiceDayType type, int& startMinute, int& endMinute) const;
+    void roll(int32_t todayKey);
+    void learn(int index);
+    void save();
+};
+
+extern ServiceHours serviceHours;
+
+#endif // SERVICE_HOURS_H
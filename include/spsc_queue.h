@@ -0,0 +1,56 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// ============================================================================
+// SINGLE-PRODUCER / SINGLE-CONSUMER QUEUE
+// Lock-free ring for handing work between exactly two tasks. Slots are
+// filled and read in place: the producer claims a slot, fills it and
+// publishes it; the consumer peeks, uses and pops it. Each side only ever
+// writes its own index, so no lock or critical section is needed.
+// ============================================================================
+
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer: free slot to fill, or nullptr when the queue is full
+    T* claim() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) return nullptr;
+        return &slots[h & (N - 1)];
+    }
+
+    // Producer: hand the claimed slot to the consumer
+    void publish() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: oldest published slot, or nullptr when empty
+    T* peek() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return nullptr;
+        return &slots[t & (N - 1)];
+    }
+
+    // Consumer: give the peeked slot back to the producer
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T slots[N];
+    std::atomic<size_t> head;   // Written by the producer only
+    std::atomic<size_t> tail;   // Written by the consumer only
+};
+
+#endif // SPSC_QUEUE_H
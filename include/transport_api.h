@@ -45,6 +45,10 @@ public:
     // Switch direction
     void setDirection(Direction dir);
     Direction getDirection() const;
+    
+    // Stops to fetch, bit i = i-th stop of the direction (forced refetches take all)
+    void setStopMask(uint8_t mask);
+    uint8_t getStopMask() const { return stopMask; }
     String getDirectionLabel() const;
     
     // Get last error
@@ -58,6 +62,7 @@ private:
     String lastError;
     WiFiClientSecure secureClient;
     int lastApiCallCount;  // Track API calls made in last fetch
+    uint8_t stopMask;
     
     // Stop configurations
     static const BusStop cheltenhamStops[];
@@ -0,0 +1,68 @@
+#ifndef VOLATILITY_H
+#define VOLATILITY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "display.h"
+#if USE_NEXTBUS_API
+#include "nextbus_api.h"
+#else
+#include "transport_api.h"
+#endif
+
+// ============================================================================
+// DATA VOLATILITY TRACKER
+// Compares each fetched timetable with the previous one for the same
+// direction. It counts departures added or removed, expected times that
+// moved and live/scheduled flips; buses that simply left or became too
+// close to walk to, and buses that came into view behind the previous last
+// one, are not changes.
+// Each stop keeps a smoothed change score. The scheduler stretches the fetch
+// interval when fetches keep coming back identical, and shortens it while
+// live times are moving.
+// ============================================================================
+
+class VolatilityTracker {
+public:
+    VolatilityTracker();
+
+    // Compare a fresh timetable with the last one for this direction
+    void update(Direction dir, const BusDeparture* departures, int count);
+
+    // Multiplier for the budget planner's fetch interval
+    float intervalScale(Direction dir) const;
+
+    int getLastChanges() const { return lastChanges; }
+    int getUnchangedStreak(Direction dir) const;
+
+private:
+    struct SnapshotEntry {
+        uint32_t key;           // Route and stop hash
+        uint32_t stopKey;       // Stop hash
+        int16_t minute;         // Departure minute of day (expected when live)
+        int16_t walk;           // Walking time - the parser drops buses closer than this
+        bool live;
+    };
+    struct StopScore {
+        uint32_t stopKey;       // 0 = free
+        float score;            // Smoothed changes per departure, 0..1+
+    };
+    struct DirectionState {
+        SnapshotEntry entries[VOLATILITY_SNAPSHOT_SIZE];
+        int count;
+        bool primed;            // A previous snapshot exists
+        int unchangedStreak;
+        StopScore stops[VOLATILITY_MAX_STOPS];
+    };
+
+    DirectionState state[2];
+    int lastChanges;
+
+    static uint32_t hash(const char* text, uint32_t seed = 2166136261u);
+    static int departureMinute(const BusDeparture& departure);
+    StopScore* stopScore(DirectionState& s, uint32_t stopKey);
+};
+
+extern VolatilityTracker volatility;
+
+#endif // VOLATILITY_H
@@ -2,32 +2,49 @@
 #define WEATHER_H
 
 #include <Arduino.h>
+#include <WiFiClientSecure.h>
 #include "config.h"
 
+// ============================================================================
+// WEATHER CLIENT
+// Fetches current conditions from OpenWeatherMap as a low-frequency job in
+// the shared network window. The response is parsed straight off the socket
+// through a filter that keeps only temperature, condition and icon, into a
+// static arena, and the result is cached with a TTL for the hero header.
+// ============================================================================
+
 struct WeatherData {
     float temperature;      // Celsius
-    int humidity;           // Percentage
-    String condition;       // "Clear", "Clouds", "Rain", etc.
-    String icon;            // Icon code
+    char condition[16];     // "Clear", "Clouds", "Rain", etc.
+    char icon[8];           // Icon code
+    unsigned long fetchedAt;
     bool valid;
 };
 
 class WeatherClient {
 public:
     WeatherClient();
-    
+
+    void init();
     bool fetchWeather();
-    WeatherData getWeather() const { return currentWeather; }
-    String getLastError() const { return lastError; }
-    
+    const WeatherData& getWeather() const { return currentWeather; }
+    const char* getLastError() const { return lastError; }
+
+    // Cached reading is younger than WEATHER_CACHE_TTL_MS
+    bool isFresh() const;
+
+    // Short header label such as "14C Rain", empty once the cache has expired
+    void formatLabel(char* out, size_t outSize) const;
+
 private:
     WeatherData currentWeather;
-    String lastError;
-    
-    bool parseResponse(const String& json);
+    char lastError[24];
+    WiFiClientSecure secureClient;
+
+    bool parseResponse(Stream& stream);
+    bool parseDocument(Stream& stream);     // JSON documents live only inside this call
 };
 
 extern WeatherClient weatherClient;
 
 #endif
-
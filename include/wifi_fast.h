@@ -0,0 +1,51 @@
+#ifndef WIFI_FAST_H
+#define WIFI_FAST_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+
+// ============================================================================
+// FAST WIFI CONNECT
+// Remembers the BSSID, channel and IP settings of the last good connection
+// (RTC memory for deep sleep wakes, NVS for power cycles) and tries a direct
+// association on that channel first. Falls back to the normal full scan when
+// the access point has moved or the cached entry is for another network.
+// ============================================================================
+
+struct WiFiLinkCache;
+
+class FastWiFi {
+public:
+    FastWiFi();
+
+    // Connect to ssid - fast path first, full scan on failure
+    bool connect(const char* ssid, const char* password, int timeoutMs);
+
+    // Non-blocking variant for background reconnects: starts an association
+    // and returns at once. Returns true if the fast path was used
+    bool beginConnect(const char* ssid, const char* password, bool allowFast);
+
+    // Record a finished connect (updates the cache and latency stats)
+    void noteConnected(const char* ssid, unsigned long startTime, bool fast);
+
+    // Forget the cached access point (e.g. after a credentials change)
+    void forget();
+
+    // Latency of the last successful connect and which path it took
+    unsigned long getLastConnectMs() const;
+    bool lastConnectWasFast() const;
+
+private:
+    unsigned long lastConnectMs;
+    bool lastFast;
+
+    bool loadCache(WiFiLinkCache& cache);
+    void saveCache(const char* ssid);
+    void applyIpConfig(const WiFiLinkCache* cache);
+    bool waitForConnection(unsigned long startTime, int timeoutMs);
+};
+
+extern FastWiFi fastWiFi;
+
+#endif // WIFI_FAST_H
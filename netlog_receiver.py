@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+Network log receiver for the bus timetable display
+Listens for the batched syslog datagrams sent by the firmware's network
+log sink (NETLOG_ENABLED in config.h) and prints them in a readable form
+
+Usage:
+    python3 netlog_receiver.py                 # listen on 0.0.0.0:5514
+    python3 netlog_receiver.py --port 5514 --log display.log
+"""
+
+import argparse
+import re
+import socket
+import sys
+from datetime import datetime
+
+SEVERITIES = {
+    0: "EMERG", 1: "ALERT", 2: "CRIT", 3: "ERROR",
+    4: "WARN", 5: "NOTICE", 6: "INFO", 7: "DEBUG",
+}
+
+# <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [meta@32473 up="s.ms" seq="n"] MSG
+LINE_PATTERN = re.compile(
+    r'^<(?P<pri>\d+)>1 (?P<ts>\S+) (?P<host>\S+) (?P<app>\S+) \S+ \S+ '
+    r'\[meta@32473 up="(?P<up>[\d.]+)" seq="(?P<seq>\d+)"\] (?P<msg>.*)$'
+)
+
+
+def parse_line(line):
+    """Parse one syslog line from the firmware, returns dict or None"""
+    match = LINE_PATTERN.match(line)
+    if not match:
+        return None
+    pri = int(match.group("pri"))
+    return {
+        "severity": SEVERITIES.get(pri % 8, str(pri % 8)),
+        "timestamp": match.group("ts"),
+        "host": match.group("host"),
+        "uptime": float(match.group("up")),
+        "seq": int(match.group("seq")),
+        "message": match.group("msg"),
+    }
+
+
+def format_record(record, sender):
+    """Format a parsed record for the terminal"""
+    ts = record["timestamp"] if record["timestamp"] != "-" else "(no time)"
+    return (f"{ts} {record['host']}@{sender} up={record['uptime']:>10.3f}s "
+            f"#{record['seq']:<6} {record['severity']:<5} {record['message']}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Receive bus display network logs")
+    parser.add_argument("--bind", default="0.0.0.0", help="Address to listen on")
+    parser.add_argument("--port", type=int, default=5514, help="UDP port (NETLOG_PORT)")
+    parser.add_argument("--log", help="Also append decoded records to this file")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    print(f"Listening for network logs on {args.bind}:{args.port}")
+
+    log_file = open(args.log, "a") if args.log else None
+    last_seq = {}
+
+    try:
+        while True:
+            data, (sender, _) = sock.recvfrom(2048)
+            received = datetime.now().strftime("%H:%M:%S")
+            for raw in data.decode("utf-8", errors="replace").splitlines():
+                record = parse_line(raw)
+                if record is None:
+                    output = f"{received} {sender} ?? {raw}"
+                else:
+                    # Sequence numbers restart at 0 on reboot, gaps mean lost datagrams
+                    previous = last_seq.get(sender)
+                    if previous is not None and record["seq"] > previous + 1:
+                        gap = f"--- {record['seq'] - previous - 1} record(s) missing from {sender} ---"
+                        print(gap)
+                        if log_file:
+                            log_file.write(gap + "\n")
+                    last_seq[sender] = record["seq"]
+                    output = format_record(record, sender)
+                print(output)
+                if log_file:
+                    log_file.write(output + "\n")
+                    log_file.flush()
+    except KeyboardInterrupt:
+        print("\nStopped")
+    finally:
+        if log_file:
+            log_file.close()
+        sock.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""
+Caching SIRI-SM proxy for the bus timetable displays
+Polls Traveline once per configured stop on the same budget schedule the
+firmware uses, and serves the cached responses to any number of displays.
+Point NEXTBUS_API_BASE / NEXTBUS_API_HOST / NEXTBUS_API_PORT in config.h
+at this host and a house full of displays costs one display's API calls.
+
+Endpoints:
+    POST /<anything>          SIRI-SM StopMonitoringRequest, answered from cache
+                              (same interface as nextbus.mxdata.co.uk)
+    GET  /compact/<atcocode>  Pre-parsed departures in a packed binary form
+    GET  /status              Cache ages and API usage as JSON
+
+Stop codes, the daily limit and active hours are read from include/config.h
+and the Nextbus credentials from src/secrets.h, so the proxy polls exactly
+what the firmware would.
+
+Usage:
+    python3 siri_proxy.py                        # listen on 0.0.0.0:8080
+    python3 siri_proxy.py --port 8080 --stop 1600GL1189
+
+Only the configured stops (config.h plus --stop) are served; a request
+for any other MonitoringRef gets a 404 and costs no API call.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+import threading
+import time
+from datetime import datetime, timezone
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from xml.etree import ElementTree as ET
+
+import requests
+
+UPSTREAM = "http://nextbus.mxdata.co.uk/nextbuses/1.0/1"
+SIRI_NS = {"siri": "http://www.siri.org.uk/"}
+
+# Stops the firmware polls (nextbus_api.cpp cheltenhamStops / churchdownStops)
+FIRMWARE_STOPS = ["STOP_LIBRARY", "STOP_HARE_HOUNDS", "STOP_ST_JOHNS", "STOP_PROM_3", "STOP_PROM_5"]
+
+# Same clamps as calculateOptimalRefreshInterval() in main.cpp
+MIN_INTERVAL_S = 300
+MAX_INTERVAL_S = 1800
+LOW_BUDGET_MAX_INTERVAL_S = 3600
+LOW_BUDGET_CALLS = 50
+
+# /compact/<atcocode> layout (little endian):
+#   header:    uint32 fetched_epoch, uint16 count
+#   departure: char[8] route, char[32] destination,
+#              uint32 aimed_epoch, uint32 expected_epoch (0 = scheduled only)
+COMPACT_HEADER = struct.Struct("<IH")
+COMPACT_DEPARTURE = struct.Struct("<8s32sII")
+
+DEFINE_PATTERN = re.compile(r'^#define\s+(\w+)\s+("([^"]*)"|\S+)', re.MULTILINE)
+
+
+def read_defines(path):
+    """Collect #define NAME value pairs from a firmware header"""
+    defines = {}
+    try:
+        text = Path(path).read_text()
+    except OSError:
+        return defines
+    for match in DEFINE_PATTERN.finditer(text):
+        defines[match.group(1)] = match.group(3) if match.group(3) is not None else match.group(2)
+    return defines
+
+
+def build_siri_request(atcocode, username, message_id):
+    """Build a SIRI-SM request (mirrors NextbusAPIClient::buildSiriRequest)"""
+    timestamp = datetime.now(timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+    return f'''<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<Siri version="1.0" xmlns="http://www.siri.org.uk/">
+    <ServiceRequest>
+        <RequestTimestamp>{timestamp}</RequestTimestamp>
+        <RequestorRef>{username}</RequestorRef>
+        <StopMonitoringRequest version="1.0">
+            <RequestTimestamp>{timestamp}</RequestTimestamp>
+            <MessageIdentifier>{message_id}</MessageIdentifier>
+            <MonitoringRef>{atcocode}</MonitoringRef>
+        </StopMonitoringRequest>
+    </ServiceRequest>
+</Siri>'''
+
+
+def parse_iso_epoch(value):
+    """ISO 8601 with Z or an offset to epoch seconds, 0 if missing"""
+    if not value:
+        return 0
+    try:
+        return int(datetime.fromisoformat(value.strip().replace("Z", "+00:00")).timestamp())
+    except ValueError:
+        return 0
+
+
+def parse_siri_response(xml_text):
+    """Extract departures (mirrors NextbusAPIClient::parseSiriResponse, minus the
+    per-display route and direction filters, which stay on the device)"""
+    try:
+        root = ET.fromstring(xml_text)
+    except ET.ParseError:
+        return []
+    departures = []
+    for visit in root.findall(".//siri:MonitoredStopVisit", SIRI_NS):
+        route = visit.findtext(".//siri:PublishedLineName", "", SIRI_NS).strip()
+        direction = visit.findtext(".//siri:DirectionName", "", SIRI_NS).strip()
+        call = visit.find(".//siri:MonitoredCall", SIRI_NS)
+        if not route or call is None:
+            continue
+        departures.append({
+            "route": route,
+            "destination": direction,
+            "aimed": parse_iso_epoch(call.findtext("siri:AimedDepartureTime", "", SIRI_NS)),
+            "expected": parse_iso_epoch(call.findtext("siri:ExpectedDepartureTime", "", SIRI_NS)),
+        })
+    return departures
+
+
+def pack_compact(entry):
+    """Pack a cache entry for /compact"""
+    departures = entry["departures"]
+    out = [COMPACT_HEADER.pack(int(entry["fetched"]), len(departures))]
+    for dep in departures:
+        out.append(COMPACT_DEPARTURE.pack(dep["route"].encode()[:8], dep["destination"].encode()[:32],
+                                          dep["aimed"], dep["expected"]))
+    return b"".join(out)
+
+
+class StopCache:
+    """Latest upstream response per stop plus the day's API usage"""
+
+    def __init__(self, stops, username, password, daily_limit, active_start, active_end):
+        self.stops = list(stops)
+        self.username = username
+        self.password = password
+        self.daily_limit = daily_limit
+        self.active_start = active_start
+        self.active_end = active_end
+        self.entries = {}
+        self.lock = threading.Lock()
+        self.calls_today = 0
+        self.day = datetime.now().day
+        self.message_id = 1
+
+    def is_configured(self, atcocode):
+        """Only the configured stops are ever fetched - an arbitrary
+        MonitoringRef from the LAN must not spend the shared budget"""
+        return atcocode in self.stops
+
+    def _roll_day(self):
+        """Reset the counter at midnight (caller holds the lock)"""
+        today = datetime.now().day
+        if today != self.day:
+            self.day = today
+            self.calls_today = 0
+
+    def get(self, atcocode):
+        with self.lock:
+            return self.entries.get(atcocode)
+
+    def fetch(self, atcocode):
+        """One upstream call; keeps the previous entry on failure.
+        Called from the poll thread and from handler threads."""
+        with self.lock:
+            self._roll_day()
+            if self.calls_today >= self.daily_limit:
+                print(f"{atcocode}: daily limit of {self.daily_limit} calls reached")
+                return False
+            message_id = self.message_id
+            self.message_id += 1
+            self.calls_today += 1
+            calls = self.calls_today
+        body = build_siri_request(atcocode, self.username, message_id)
+        try:
+            response = requests.post(UPSTREAM, data=body, auth=(self.username, self.password),
+                                     headers={"Content-Type": "application/xml"}, timeout=15)
+        except requests.RequestException as exc:
+            print(f"{atcocode}: upstream error {exc}")
+            return False
+        if response.status_code != 200:
+            print(f"{atcocode}: upstream HTTP {response.status_code}")
+            return False
+        departures = parse_siri_response(response.text)
+        with self.lock:
+            self.entries[atcocode] = {
+                "xml": response.content,
+                "departures": departures,
+                "fetched": time.time(),
+            }
+        print(f"{datetime.now():%H:%M:%S} {atcocode}: {len(departures)} departures "
+              f"({calls}/{self.daily_limit} calls today)")
+        return True
+
+    def next_interval(self):
+        """Seconds until the next poll cycle (the firmware's budget planner).
+        Read-only; the caller holds the lock."""
+        now = datetime.now()
+        if now.hour < self.active_start:
+            remaining_hours = self.active_end - self.active_start
+        elif now.hour >= self.active_end:
+            remaining_hours = 0
+        else:
+            remaining_hours = self.active_end - now.hour
+        if remaining_hours <= 0:
+            return MAX_INTERVAL_S
+
+        remaining_calls = self.daily_limit - self.calls_today
+        cycles = remaining_calls // max(1, len(self.stops))
+        if cycles <= 0:
+            return LOW_BUDGET_MAX_INTERVAL_S
+
+        interval = remaining_hours * 3600 / cycles
+        if interval < MIN_INTERVAL_S:
+            return MIN_INTERVAL_S
+        if interval > LOW_BUDGET_MAX_INTERVAL_S:
+            return LOW_BUDGET_MAX_INTERVAL_S
+        if interval > MAX_INTERVAL_S and remaining_calls > LOW_BUDGET_CALLS:
+            return MAX_INTERVAL_S
+        return interval
+
+    def is_active(self):
+        return self.active_start <= datetime.now().hour < self.active_end
+
+    def poll_forever(self):
+        while True:
+            with self.lock:
+                self._roll_day()
+            if self.is_active():
+                for atcocode in self.stops:
+                    self.fetch(atcocode)
+            with self.lock:
+                interval = self.next_interval()
+            time.sleep(interval)
+
+
+def make_handler(cache):
+    class ProxyHandler(BaseHTTPRequestHandler):
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", 0))
+            body = self.rfile.read(length).decode("utf-8", errors="replace")
+            match = re.search(r"<MonitoringRef>\s*([^<\s]+)\s*</MonitoringRef>", body)
+            if not match:
+                self.send_error(400, "No MonitoringRef")
+                return
+            atcocode = match.group(1)
+            if not cache.is_configured(atcocode):
+                self.send_error(404, "Stop not configured on the proxy")
+                return
+            entry = cache.get(atcocode)
+            if entry is None:
+                # Configured but not polled yet (startup, or the last poll failed)
+                cache.fetch(atcocode)
+                entry = cache.get(atcocode)
+            if entry is None:
+                self.send_error(502, "No cached response")
+                return
+            # The Date header lets the display set its clock from us
+            self.send_response(200)
+            self.send_header("Content-Type", "application/xml")
+            self.send_header("Content-Length", str(len(entry["xml"])))
+            self.end_headers()
+            self.wfile.write(entry["xml"])
+
+        def do_GET(self):
+            if self.path.startswith("/compact/"):
+                entry = cache.get(self.path[len("/compact/"):])
+                if entry is None:
+                    self.send_error(404, "Stop not cached")
+                    return
+                payload = pack_compact(entry)
+                content_type = "application/octet-stream"
+            elif self.path == "/status":
+                now = time.time()
+                with cache.lock:
+                    status = {
+                        "calls_today": cache.calls_today,
+                        "daily_limit": cache.daily_limit,
+                        "next_interval_s": round(cache.next_interval()),
+                        "stops": {code: round(now - e["fetched"]) for code, e in cache.entries.items()},
+                    }
+                payload = json.dumps(status, indent=2).encode()
+                content_type = "application/json"
+            else:
+                self.send_error(404)
+                return
+            self.send_response(200)
+            self.send_header("Content-Type", content_type)
+            self.send_header("Content-Length", str(len(payload)))
+            self.end_headers()
+            self.wfile.write(payload)
+
+        def log_message(self, fmt, *args):
+            print(f"{datetime.now():%H:%M:%S} {self.client_address[0]} {fmt % args}")
+
+    return ProxyHandler
+
+
+def main():
+    repo = Path(__file__).resolve().parent
+    parser = argparse.ArgumentParser(description="Caching SIRI-SM proxy for bus displays")
+    parser.add_argument("--bind", default="0.0.0.0", help="Address to listen on")
+    parser.add_argument("--port", type=int, default=8080, help="HTTP port (NEXTBUS_API_PORT)")
+    parser.add_argument("--config", default=repo / "include" / "config.h", help="Firmware config.h")
+    parser.add_argument("--secrets", default=repo / "src" / "secrets.h", help="Firmware secrets.h")
+    parser.add_argument("--stop", action="append", default=[], help="Extra ATCO code to poll")
+    args = parser.parse_args()
+
+    config = read_defines(args.config)
+    secrets = read_defines(args.secrets)
+    username = secrets.get("SECRET_NEXTBUS_USERNAME", "")
+    password = secrets.get("SECRET_NEXTBUS_PASSWORD", "")
+    if not username or username.startswith("your_"):
+        print(f"No Nextbus credentials in {args.secrets}")
+        return 1
+
+    stops = [config[name] for name in FIRMWARE_STOPS if name in config] + args.stop
+    cache = StopCache(stops, username, password,
+                      int(config.get("NEXTBUS_API_DAILY_LIMIT", 1000)),
+                      int(config.get("ACTIVE_HOURS_START", 6)),
+                      int(config.get("ACTIVE_HOURS_END", 23)))
+
+    threading.Thread(target=cache.poll_forever, daemon=True).start()
+
+    server = ThreadingHTTPServer((args.bind, args.port), make_handler(cache))
+    print(f"SIRI proxy for {len(stops)} stops on {args.bind}:{args.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\nStopped")
+    finally:
+        server.server_close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,136 @@
+#include "battery_monitor.h"
+
+// ============================================================================
+// BATTERY MONITOR IMPLEMENTATION
+// ============================================================================
+
+BatteryMonitor batteryMonitor;
+
+// Kalman tuning: the battery voltage barely moves between samples, the ADC
+// reading scatters by a few tens of millivolts
+static const float BATTERY_PROCESS_NOISE = 1e-6f;        // V^2 per sample
+static const float BATTERY_MEASUREMENT_NOISE = 4e-4f;    // V^2 (20 mV sigma)
+static const int BATTERY_SETTLE_SAMPLES = 10;
+
+BatteryMonitor::BatteryMonitor() {
+    estimate = 0;
+    errorCovariance = 1.0f;
+    sampleCount = 0;
+    lastSample = 0;
+    trendHead = 0;
+    trendCount = 0;
+    lastTrendPoint = 0;
+    slopePerHour = 0;
+}
+
+void BatteryMonitor::init() {
+    analogSetPinAttenuation(BATTERY_PIN, ADC_11db);
+
+    // Seed the filter from a short burst so the first reading is usable
+    float sum = 0;
+    const int seedSamples = 4;
+    for (int i = 0; i < seedSamples; i++) {
+        sum += readVoltage();
+    }
+    estimate = sum / seedSamples;
+    errorCovariance = BATTERY_MEASUREMENT_NOISE / seedSamples;
+    sampleCount = seedSamples;
+    lastSample = millis();
+    lastTrendPoint = lastSample;
+    addTrendPoint(lastSample);
+
+    DEBUG_PRINTF("Battery monitor: %.2fV (%d%%)\n", estimate, getPercent());
+}
+
+float BatteryMonitor::readVoltage() {
+    // analogReadMilliVolts() applies the eFuse ADC calibration
+    uint32_t mv = analogReadMilliVolts(BATTERY_PIN);
+    return (mv / 1000.0f) * BATTERY_VOLTAGE_DIVIDER;
+}
+
+float BatteryMonitor::voltageToPercent(float voltage) const {
+    if (voltage >= BATTERY_VOLTAGE_FULL) return 100.0f;
+    float percent = (voltage - BATTERY_VOLTAGE_EMPTY) /
+                    (BATTERY_VOLTAGE_FULL - BATTERY_VOLTAGE_EMPTY) * 100.0f;
+    return constrain(percent, 0.0f, 100.0f);
+}
+
+void BatteryMonitor::loop() {
+    unsigned long now = millis();
+    if (now - lastSample < BATTERY_SAMPLE_INTERVAL_MS) return;
+    lastSample = now;
+
+    // Scalar Kalman update
+    float measured = readVoltage();
+    errorCovariance += BATTERY_PROCESS_NOISE;
+    float gain = errorCovariance / (errorCovariance + BATTERY_MEASUREMENT_NOISE);
+    estimate += gain * (measured - estimate);
+    errorCovariance *= (1.0f - gain);
+    sampleCount++;
+
+    if (now - lastTrendPoint >= BATTERY_TREND_INTERVAL_MS) {
+        lastTrendPoint = now;
+        addTrendPoint(now);
+    }
+}
+
+void BatteryMonitor::addTrendPoint(unsigned long now) {
+    int slot = (trendHead + trendCount) % BATTERY_TREND_POINTS;
+    if (trendCount < BATTERY_TREND_POINTS) {
+        trendCount++;
+    } else {
+        trendHead = (trendHead + 1) % BATTERY_TREND_POINTS;
+    }
+    trendPercent[slot] = voltageToPercent(estimate);
+    trendTime[slot] = now;
+
+    if (trendCount < 3) {
+        slopePerHour = 0;
+        return;
+    }
+
+    // Least-squares slope over the window, time in hours relative to the oldest point
+    unsigned long t0 = trendTime[trendHead];
+    float sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    for (int i = 0; i < trendCount; i++) {
+        int idx = (trendHead + i) % BATTERY_TREND_POINTS;
+        float x = (trendTime[idx] - t0) / 3600000.0f;
+        float y = trendPercent[idx];
+        sumX += x;
+        sumY += y;
+        sumXY += x * y;
+        sumXX += x * x;
+    }
+    float denom = trendCount * sumXX - sumX * sumX;
+    slopePerHour = denom > 0 ? (trendCount * sumXY - sumX * sumY) / denom : 0;
+
+    DEBUG_PRINTF("Battery trend: %.2fV %d%%, %.2f %%/h over %d points\n",
+                 estimate, getPercent(), slopePerHour, trendCount);
+}
+
+float BatteryMonitor::getVoltage() const {
+    return estimate;
+}
+
+int BatteryMonitor::getPercent() const {
+    return (int)(voltageToPercent(estimate) + 0.5f);
+}
+
+float BatteryMonitor::getDischargeRatePerHour() const {
+    return slopePerHour < 0 ? -slopePerHour : 0;
+}
+
+float BatteryMonitor::getHoursRemaining() const {
+    // Needs a real downward trend - the flat top of a full cell says nothing
+    if (trendCount < 3 || slopePerHour > -0.05f) return -1;
+    float hours = voltageToPercent(estimate) / -slopePerHour;
+    return min(hours, 999.0f);
+}
+
+bool BatteryMonitor::isCharging() const {
+    return trendCount >= 3 && slopePerHour > 0.5f;
+}
+
+bool BatteryMonitor::isReliable() const {
+    return sampleCount >= BATTERY_SETTLE_SAMPLES;
+}
@@ -0,0 +1,242 @@
+#include "black_box.h"
+#include <esp_system.h>
+#include <esp_attr.h>
+#include <time.h>
+
+// ============================================================================
+// BLACK BOX RECORDER IMPLEMENTATION
+// ============================================================================
+
+BlackBox blackBox;
+
+static const uint32_t BLACKBOX_MAGIC = 0xB1ACB0C5;
+
+// Lives in RTC slow memory and is NOT zeroed on reset - validated by magic
+// and checksum instead, so a power-on reset simply starts a fresh ring
+struct BlackBoxStore {
+    uint32_t magic;
+    uint32_t bootCount;
+    uint8_t resetReason;    // Reason for the most recent boot
+    uint8_t head;           // Index of the oldest record
+    uint8_t count;
+    uint8_t reserved;
+    CycleRecord records[BLACKBOX_RECORDS];
+    uint32_t checksum;
+};
+
+static RTC_NOINIT_ATTR BlackBoxStore store;
+
+static uint32_t storeChecksum() {
+    // FNV-1a over everything before the checksum field
+    const uint8_t* bytes = (const uint8_t*)&store;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(BlackBoxStore, checksum); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const char* resetReasonName(uint8_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON:   return "power_on";
+        case ESP_RST_EXT:       return "external";
+        case ESP_RST_SW:        return "software";
+        case ESP_RST_PANIC:     return "panic";
+        case ESP_RST_INT_WDT:   return "interrupt_watchdog";
+        case ESP_RST_TASK_WDT:  return "task_watchdog";
+        case ESP_RST_WDT:       return "watchdog";
+        case ESP_RST_DEEPSLEEP: return "deep_sleep";
+        case ESP_RST_BROWNOUT:  return "brownout";
+        default:                return "unknown";
+    }
+}
+
+static const char* phaseName(uint8_t phase) {
+    switch (phase) {
+        case PHASE_START:  return "start";
+        case PHASE_HTTP:   return "http";
+        case PHASE_PARSE:  return "parse";
+        case PHASE_RENDER: return "render";
+        case PHASE_DONE:   return "done";
+        default:           return "idle";
+    }
+}
+
+BlackBox::BlackBox() {
+    cycleOpen = false;
+    pendingReport = false;
+    currentPhase = PHASE_IDLE;
+    phaseStart = 0;
+    renderRecord = -1;
+}
+
+void BlackBox::init() {
+    bool valid = store.magic == BLACKBOX_MAGIC &&
+                 store.checksum == storeChecksum() &&
+                 store.count <= BLACKBOX_RECORDS &&
+                 store.head < BLACKBOX_RECORDS;
+
+    if (!valid) {
+        memset(&store, 0, sizeof(store));
+        store.magic = BLACKBOX_MAGIC;
+    }
+
+    store.bootCount++;
+    store.resetReason = (uint8_t)esp_reset_reason();
+    seal();
+
+    // Anything recorded before this boot is worth reporting once
+    pendingReport = store.count > 0;
+
+    DEBUG_PRINTF("Black box: %s, %d records, boot #%lu, reset reason: %s\n",
+                 valid ? "restored" : "fresh", store.count,
+                 (unsigned long)store.bootCount, resetReasonName(store.resetReason));
+
+    if (valid && store.count > 0) {
+        const CycleRecord& last = store.records[(store.head + store.count - 1) % BLACKBOX_RECORDS];
+        if (last.phase != PHASE_DONE) {
+            DEBUG_PRINTF("Black box: previous cycle stopped in phase '%s' (http %d, heap min %lu)\n",
+                         phaseName(last.phase), last.lastHttpCode, (unsigned long)last.heapMin);
+        }
+    }
+}
+
+CycleRecord* BlackBox::current() {
+    if (store.count == 0) return nullptr;
+    return &store.records[(store.head + store.count - 1) % BLACKBOX_RECORDS];
+}
+
+void BlackBox::seal() {
+    store.checksum = storeChecksum();
+}
+
+void BlackBox::accumulatePhaseTime(unsigned long now, uint32_t heap) {
+    CycleRecord* rec = current();
+    if (!rec) return;
+    uint32_t elapsed = now - phaseStart;
+    if (currentPhase == PHASE_HTTP) {
+        rec->httpMs += elapsed;
+    } else if (currentPhase == PHASE_PARSE) {
+        rec->parseMs += elapsed;
+    }
+    if (heap < rec->heapMin) rec->heapMin = heap;
+}
+
+void BlackBox::beginCycle(int budgetUsed) {
+    uint32_t heap = ESP.getFreeHeap();
+    portENTER_CRITICAL(&lock);
+
+    // Append a new record, overwriting the oldest when the ring is full
+    if (store.count < BLACKBOX_RECORDS) {
+        store.count++;
+    } else {
+        store.head = (store.head + 1) % BLACKBOX_RECORDS;
+    }
+    int index = (store.head + store.count - 1) % BLACKBOX_RECORDS;
+    if (index == renderRecord) renderRecord = -1;  // Its render never came back - overwritten now
+
+    CycleRecord* rec = current();
+    memset(rec, 0, sizeof(CycleRecord));
+    rec->uptimeS = millis() / 1000;
+    time_t now = time(nullptr);
+    rec->epoch = (now > 1600000000) ? (uint32_t)now : 0;
+    rec->heapMin = heap;
+    rec->budgetUsed = (uint16_t)max(0, budgetUsed);
+    rec->phase = PHASE_START;
+
+    cycleOpen = true;
+    currentPhase = PHASE_START;
+    phaseStart = millis();
+    seal();
+    portEXIT_CRITICAL(&lock);
+}
+
+void BlackBox::markPhase(CyclePhase phase) {
+    if (!cycleOpen) return;
+    uint32_t heap = ESP.getFreeHeap();
+    unsigned long now = millis();
+    portENTER_CRITICAL(&lock);
+    accumulatePhaseTime(now, heap);
+    currentPhase = phase;
+    phaseStart = now;
+    current()->phase = phase;
+    seal();
+    portEXIT_CRITICAL(&lock);
+}
+
+void BlackBox::noteHttpCode(int httpCode) {
+    if (!cycleOpen) return;
+    portENTER_CRITICAL(&lock);
+    current()->lastHttpCode = (int16_t)httpCode;
+    seal();
+    portEXIT_CRITICAL(&lock);
+}
+
+void BlackBox::endCycle(bool success, int busCount, int apiCalls, int budgetUsed) {
+    if (!cycleOpen) return;
+    uint32_t heap = ESP.getFreeHeap();
+    unsigned long now = millis();
+    portENTER_CRITICAL(&lock);
+    accumulatePhaseTime(now, heap);
+    CycleRecord* rec = current();
+    rec->phase = PHASE_RENDER;  // DONE once noteRender() comes back
+    rec->success = success ? 1 : 0;
+    rec->busCount = (uint8_t)constrain(busCount, 0, 255);
+    rec->apiCalls = (uint8_t)constrain(apiCalls, 0, 255);
+    rec->budgetUsed = (uint16_t)max(0, budgetUsed);
+    renderRecord = (store.head + store.count - 1) % BLACKBOX_RECORDS;
+    cycleOpen = false;
+    currentPhase = PHASE_IDLE;
+    seal();
+    portEXIT_CRITICAL(&lock);
+}
+
+void BlackBox::noteRender(uint32_t ms) {
+    portENTER_CRITICAL(&lock);
+    if (renderRecord >= 0) {
+        CycleRecord& rec = store.records[renderRecord];
+        rec.renderMs = ms;
+        rec.phase = PHASE_DONE;
+        renderRecord = -1;
+        seal();
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+bool BlackBox::hasPendingReport() const {
+    return pendingReport;
+}
+
+void BlackBox::markReported() {
+    pendingReport = false;
+}
+
+const char* BlackBox::getResetReasonName() const {
+    return resetReasonName(store.resetReason);
+}
+
+String BlackBox::toJson() const {
+    String json;
+    json.reserve(160 + store.count * 170);
+    json += "{\"boot\":" + String((unsigned long)store.bootCount);
+    json += ",\"reset_reason\":\"" + String(resetReasonName(store.resetReason)) + "\"";
+    json += ",\"budget_limit\":" + String(API_DAILY_LIMIT);
+    json += ",\"cycles\":[";
+    for (int i = 0; i < store.count; i++) {
+        const CycleRecord& rec = store.records[(store.head + i) % BLACKBOX_RECORDS];
+        char buf[200];
+        snprintf(buf, sizeof(buf),
+                 "%s{\"up\":%lu,\"time\":%lu,\"phase\":\"%s\",\"ok\":%d,\"http\":%d,"
+                 "\"http_ms\":%lu,\"parse_ms\":%lu,\"render_ms\":%lu,\"heap_min\":%lu,"
+                 "\"calls\":%d,\"buses\":%d,\"budget_used\":%d}",
+                 i > 0 ? "," : "",
+                 (unsigned long)rec.uptimeS, (unsigned long)rec.epoch, phaseName(rec.phase),
+                 rec.success, rec.lastHttpCode,
+                 (unsigned long)rec.httpMs, (unsigned long)rec.parseMs, (unsigned long)rec.renderMs,
+                 (unsigned long)rec.heapMin, rec.apiCalls, rec.busCount, rec.budgetUsed);
+        json += buf;
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,186 @@
+#include "clock_service.h"
+#include "net_log.h"
+#include <sys/time.h>
+#include "esp_sntp.h"
+
+// ============================================================================
+// CLOCK SERVICE IMPLEMENTATION
+// ============================================================================
+
+ClockService clockService;
+
+// Anything before this is the unset RTC counting up from 1970
+static const time_t CLOCK_MIN_VALID_EPOCH = 1600000000;
+
+// Backward steps smaller than this are held off rather than applied
+static const time_t CLOCK_MAX_HOLD_S = 60;
+
+ClockService::ClockService() {
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.valid = false;
+    lastRefresh = 0;
+    source = CLOCK_SOURCE_NONE;
+    lastSntpSync = 0;
+}
+
+void ClockService::init() {
+    // Starts SNTP in the background - nothing here waits for an answer
+    sntp_set_time_sync_notification_cb(onSntpSync);
+    configTime(0, 0, NTP_SERVER_1, NTP_SERVER_2);
+    
+    // UK time (GMT/BST) - set after configTime(), which resets TZ
+    setenv("TZ", "GMT0BST,M3.5.0/1,M10.5.0", 1);
+    tzset();
+    refresh(millis());
+}
+
+void ClockService::onSntpSync(struct timeval* tv) {
+    clockService.source = CLOCK_SOURCE_SNTP;
+    clockService.lastSntpSync = millis();
+}
+
+ClockSnapshot ClockService::refresh(unsigned long nowMs) {
+    // Both cores read the clock - work on a copy and publish it under the lock.
+    // localtime_r() may take a newlib lock, so it must run outside the critical section.
+    portENTER_CRITICAL(&lock);
+    ClockSnapshot next = snapshot;
+    portEXIT_CRITICAL(&lock);
+
+    // time() only reads the system clock - unlike getLocalTime() it never waits
+    time_t sys = time(nullptr);
+    if (sys < CLOCK_MIN_VALID_EPOCH) {
+        next.valid = false;
+    } else {
+        if (!next.valid || sys != next.epoch) {
+            next.epoch = sys;
+            localtime_r(&sys, &next.local);
+            next.minuteOfDay = next.local.tm_hour * 60 + next.local.tm_min;
+            next.dayOfMonth = next.local.tm_mday;
+            next.dayOfWeek = next.local.tm_wday;
+        }
+        next.valid = true;
+    }
+
+    portENTER_CRITICAL(&lock);
+    // Keep the snapshot monotonic across small SNTP corrections (and across a
+    // refresh on the other core); a large step means the clock was badly
+    // wrong and is taken as-is
+    bool hold = snapshot.valid && next.valid && next.epoch < snapshot.epoch &&
+                snapshot.epoch - next.epoch < CLOCK_MAX_HOLD_S;
+    if (hold) {
+        next = snapshot;
+    } else {
+        snapshot = next;
+    }
+    lastRefresh = nowMs;
+    portEXIT_CRITICAL(&lock);
+    return next;
+}
+
+ClockSnapshot ClockService::now() {
+    unsigned long nowMs = millis();
+    portENTER_CRITICAL(&lock);
+    bool stale = !snapshot.valid || nowMs - lastRefresh >= 1000;
+    ClockSnapshot copy = snapshot;
+    portEXIT_CRITICAL(&lock);
+    return stale ? refresh(nowMs) : copy;
+}
+
+bool ClockService::isValid() {
+    return now().valid;
+}
+
+String ClockService::formatHHMM() {
+    ClockSnapshot t = now();
+    if (!t.valid) return "--:--";
+    char buf[6];
+    snprintf(buf, sizeof(buf), "%02d:%02d", t.local.tm_hour, t.local.tm_min);
+    return String(buf);
+}
+
+ClockSource ClockService::getSource() const {
+    return source;
+}
+
+const char* ClockService::getSourceName() const {
+    switch (source) {
+        case CLOCK_SOURCE_HTTP: return "http";
+        case CLOCK_SOURCE_SNTP: return "sntp";
+        default:                return "none";
+    }
+}
+
+// ============================================================================
+// HTTP DATE HEADER
+// ============================================================================
+
+void ClockService::watchDateHeader(HTTPClient& http) {
+    #if CLOCK_SYNC_FROM_HTTP
+    static const char* headerKeys[] = {"Date"};
+    http.collectHeaders(headerKeys, 1);
+    #endif
+}
+
+void ClockService::syncFromResponse(HTTPClient& http) {
+    #if CLOCK_SYNC_FROM_HTTP
+    time_t serverTime = parseHttpDate(http.header("Date"));
+    if (serverTime == 0) return;
+
+    // A recent SNTP sync is more precise than a whole-second header
+    if (source == CLOCK_SOURCE_SNTP && millis() - lastSntpSync < CLOCK_SNTP_STALE_MS) {
+        return;
+    }
+
+    time_t drift = serverTime - time(nullptr);
+    if (source != CLOCK_SOURCE_NONE && abs((long)drift) <= CLOCK_HTTP_MAX_DRIFT_S) {
+        return;
+    }
+
+    setTime(serverTime, CLOCK_SOURCE_HTTP);
+    #endif
+}
+
+void ClockService::setTime(time_t epoch, ClockSource from) {
+    bool wasValid = time(nullptr) >= CLOCK_MIN_VALID_EPOCH;
+    long drift = (long)(epoch - time(nullptr));
+    
+    struct timeval tv = { epoch, 0 };
+    settimeofday(&tv, nullptr);
+    source = from;
+    refresh(millis());
+
+    if (wasValid) {
+        DEBUG_PRINTF("Clock corrected by %ld s from %s\n", drift, getSourceName());
+        netLog.log(NETLOG_INFO, "clock corrected by %ld s from %s", drift, getSourceName());
+    } else {
+        DEBUG_PRINTF("Clock set from %s at %lu ms uptime\n", getSourceName(), millis());
+        netLog.log(NETLOG_INFO, "clock set from %s", getSourceName());
+    }
+}
+
+time_t ClockService::parseHttpDate(const String& value) {
+    // IMF-fixdate, the only format servers may send: "Sun, 06 Nov 1994 08:49:37 GMT"
+    static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    int day, year, hour, minute, second;
+    char mon[4] = "";
+    if (sscanf(value.c_str(), "%*3s, %d %3s %d %d:%d:%d GMT",
+               &day, mon, &year, &hour, &minute, &second) != 6) {
+        return 0;
+    }
+    const char* found = strstr(months, mon);
+    if (!found || strlen(mon) != 3 || (found - months) % 3 != 0) return 0;
+    int month = (found - months) / 3 + 1;
+    if (year < 2020 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+
+    // Days since 1970-01-01 for a proleptic Gregorian date (no timegm() in newlib)
+    int y = year - (month <= 2 ? 1 : 0);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = (long)era * 146097 + doe - 719468;
+
+    return (time_t)days * 86400 + hour * 3600 + minute * 60 + second;
+}
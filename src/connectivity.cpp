@@ -0,0 +1,153 @@
+#include "connectivity.h"
+#include "wifi_fast.h"
+#include "mqtt_ha.h"
+#include "net_log.h"
+#include "power_policy.h"
+
+// ============================================================================
+// CONNECTIVITY MANAGER IMPLEMENTATION
+// ============================================================================
+
+ConnectivityManager connectivity;
+
+ConnectivityManager::ConnectivityManager() {
+    started = false;
+    state = LINK_DOWN;
+    gotIpEvent = false;
+    lostLinkEvent = false;
+    lastDisconnectReason = 0;
+    attemptStart = 0;
+    nextAttempt = 0;
+    backoffMs = CONN_BACKOFF_MIN_MS;
+    linkLostAt = 0;
+    disconnectCount = 0;
+    attemptFast = false;
+    nextAttemptFast = true;
+}
+
+void ConnectivityManager::begin(const String& ssid, const String& password) {
+    this->ssid = ssid;
+    this->password = password;
+    state = WiFi.status() == WL_CONNECTED ? LINK_UP : LINK_DOWN;
+    nextAttempt = millis();
+
+    // We reconnect ourselves, with backoff and the cached AP
+    WiFi.setAutoReconnect(false);
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        onWiFiEvent(event, info);
+    }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        onWiFiEvent(event, info);
+    }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+
+    started = true;
+    DEBUG_PRINTF("Connectivity manager started (link %s)\n", state == LINK_UP ? "up" : "down");
+}
+
+void ConnectivityManager::onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    // Runs on the WiFi event task - only set flags here
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        gotIpEvent = true;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        lastDisconnectReason = info.wifi_sta_disconnected.reason;
+        lostLinkEvent = true;
+    }
+}
+
+void ConnectivityManager::startAttempt(unsigned long now) {
+    attemptStart = now;
+    attemptFast = fastWiFi.beginConnect(ssid.c_str(), password.c_str(), nextAttemptFast);
+    state = LINK_CONNECTING;
+}
+
+void ConnectivityManager::attemptFailed(unsigned long now) {
+    WiFi.disconnect();
+    state = LINK_DOWN;
+
+    if (attemptFast) {
+        // Cached AP didn't answer - scan straight away
+        nextAttemptFast = false;
+        nextAttempt = now;
+        return;
+    }
+
+    DEBUG_PRINTF("WiFi reconnect failed, retrying in %lu s\n", backoffMs / 1000);
+    netLog.log(NETLOG_WARNING, "wifi reconnect failed, retry in %lu s", backoffMs / 1000);
+    nextAttempt = now + backoffMs;
+    backoffMs = min(backoffMs * 2, (unsigned long)CONN_BACKOFF_MAX_MS);
+    nextAttemptFast = true;  // The AP may be back on its old channel
+}
+
+void ConnectivityManager::loop() {
+    if (!started) return;
+    unsigned long now = millis();
+
+    if (lostLinkEvent) {
+        lostLinkEvent = false;
+        // During an attempt the timeout decides; drops are only news when up
+        if (state == LINK_UP) {
+            state = LINK_DOWN;
+            linkLostAt = now;
+            disconnectCount++;
+            backoffMs = CONN_BACKOFF_MIN_MS;
+            nextAttemptFast = true;
+            nextAttempt = now;
+            DEBUG_PRINTF("WiFi link lost (reason %d)\n", lastDisconnectReason);
+            netLog.log(NETLOG_WARNING, "wifi lost, reason %d", lastDisconnectReason);
+        }
+    }
+
+    if (gotIpEvent) {
+        gotIpEvent = false;
+        if (state != LINK_UP) {
+            if (state == LINK_CONNECTING) {
+                fastWiFi.noteConnected(ssid.c_str(), attemptStart, attemptFast);
+            }
+            state = LINK_UP;
+            backoffMs = CONN_BACKOFF_MIN_MS;
+            WiFi.setSleep(powerPolicy.settings().modemSleep);  // Connect runs with sleep off
+            if (linkLostAt != 0) {
+                DEBUG_PRINTF("WiFi link back after %lu ms\n", now - linkLostAt);
+                netLog.log(NETLOG_INFO, "wifi back after %lu ms", now - linkLostAt);
+                linkLostAt = 0;
+            }
+            mqtt.retryNow();
+        }
+    }
+
+    switch (state) {
+        case LINK_DOWN:
+            if ((long)(now - nextAttempt) >= 0) {
+                startAttempt(now);
+            }
+            break;
+
+        case LINK_CONNECTING: {
+            unsigned long timeout = attemptFast ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS;
+            if (now - attemptStart >= timeout) {
+                attemptFailed(now);
+            }
+            break;
+        }
+
+        case LINK_UP:
+            mqtt.loop();
+            break;
+    }
+}
+
+bool ConnectivityManager::isOnline() const {
+    return state == LINK_UP;
+}
+
+bool ConnectivityManager::isMqttReady() {
+    return state == LINK_UP && mqtt.isConnected();
+}
+
+LinkState ConnectivityManager::getState() const {
+    return state;
+}
+
+unsigned long ConnectivityManager::getDisconnectCount() const {
+    return disconnectCount;
+}
@@ -0,0 +1,143 @@
+#include "cycle_arena.h"
+#include "mem_policy.h"
+
+// ============================================================================
+// CYCLE ARENA IMPLEMENTATION
+// ============================================================================
+
+CycleArena cycleArena;
+
+static size_t alignUp(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+// Each block is preceded by its size, so a block that has to move when it
+// grows copies only what it holds. 8 bytes keeps the blocks 8-byte aligned.
+static const size_t BLOCK_HEADER = 8;
+
+static size_t& blockSize(void* block) {
+    return *(size_t*)((uint8_t*)block - BLOCK_HEADER);
+}
+
+// Stream sink that appends an HTTP body to the free tail of the arena
+class ArenaBodySink : public Stream {
+public:
+    ArenaBodySink(CycleArena& arena) : arena(arena), length(0), overflow(false) {}
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        // Leave room for the block header and the terminator
+        if (overflow || arena.used + BLOCK_HEADER + length + len + 1 > arena.capacity) {
+            overflow = true;
+            return 0;  // Makes writeToStream() give up on the body
+        }
+        memcpy(arena.buffer + arena.used + BLOCK_HEADER + length, data, len);
+        length += len;
+        return len;
+    }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    CycleArena& arena;
+    size_t length;
+    bool overflow;
+};
+
+CycleArena::CycleArena() {
+    buffer = nullptr;
+    capacity = 0;
+    used = 0;
+    highWater = 0;
+    last = nullptr;
+}
+
+bool CycleArena::begin() {
+    if (buffer != nullptr) return true;
+
+    // No PSRAM - a smaller block from the internal heap still stops the churn
+    size_t size = memPolicy.hasPsram() ? CYCLE_ARENA_BYTES : CYCLE_ARENA_FALLBACK_BYTES;
+    buffer = (uint8_t*)memPolicy.allocate(size, MEM_BULK);
+    capacity = buffer ? size : 0;
+
+    DEBUG_PRINTF("Cycle arena: %u bytes\n", (unsigned)capacity);
+    return buffer != nullptr;
+}
+
+void* CycleArena::alloc(size_t size) {
+    size = alignUp(size);
+    if (buffer == nullptr || used + BLOCK_HEADER + size > capacity) return nullptr;
+    last = buffer + used + BLOCK_HEADER;
+    blockSize(last) = size;
+    used += BLOCK_HEADER + size;
+    if (used > highWater) highWater = used;
+    return last;
+}
+
+char* CycleArena::copy(const char* src, size_t len) {
+    char* out = (char*)alloc(len + 1);
+    if (out == nullptr) return nullptr;
+    memcpy(out, src, len);
+    out[len] = '\0';
+    return out;
+}
+
+char* CycleArena::readBody(HTTPClient& http, size_t& length) {
+    length = 0;
+    if (buffer == nullptr) return nullptr;
+
+    ArenaBodySink sink(*this);
+    int written = http.writeToStream(&sink);
+    if (written < 0 || sink.overflow) {
+        DEBUG_PRINTF("Cycle arena: body not stored (%d, %u bytes free)\n",
+                     written, (unsigned)(capacity - used));
+        return nullptr;
+    }
+
+    // The body is already in place at the tail - claim it
+    char* body = (char*)alloc(sink.length + 1);
+    if (body == nullptr) return nullptr;  // Fitted, but not once rounded up to alignment
+    body[sink.length] = '\0';
+    length = sink.length;
+    return body;
+}
+
+void CycleArena::rewind(size_t markPos) {
+    if (markPos > used) return;
+    used = markPos;
+    last = nullptr;
+}
+
+void CycleArena::reset() {
+    used = 0;
+    last = nullptr;
+}
+
+void* CycleArena::allocate(size_t size) {
+    return alloc(size);
+}
+
+void CycleArena::deallocate(void*) {
+    // Released in bulk by rewind() or reset()
+}
+
+void* CycleArena::reallocate(void* ptr, size_t newSize) {
+    // The newest block (a JSON pool or a string being built) grows in place
+    if (ptr != nullptr && ptr == last) {
+        size_t offset = (uint8_t*)ptr - buffer;
+        newSize = alignUp(newSize);
+        if (offset + newSize > capacity) return nullptr;
+        used = offset + newSize;
+        blockSize(ptr) = newSize;
+        if (used > highWater) highWater = used;
+        return ptr;
+    }
+    // Anything else moves to the tail, copying no more than the old block held
+    void* moved = alloc(newSize);
+    if (moved && ptr) {
+        memmove(moved, ptr, min(newSize, blockSize(ptr)));
+    }
+    return moved;
+}
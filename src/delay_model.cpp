@@ -0,0 +1,121 @@
+#include "delay_model.h"
+#include <esp_attr.h>
+#include "clock_service.h"
+
+// ============================================================================
+// DELAY MODEL IMPLEMENTATION
+// ============================================================================
+
+DelayModel delayModel;
+
+static const uint32_t DELAY_MODEL_MAGIC = 0xDE1A7001;
+
+struct DelaySlot {
+    uint32_t key;           // Route, stop and bucket hash (0 = free)
+    int16_t delay16;        // Smoothed delay in 1/16 minute
+    uint8_t samples;        // Saturates at 255
+    uint8_t age;            // Observations since this slot was last updated, saturating
+};
+
+static RTC_DATA_ATTR uint32_t tableMagic;
+static RTC_DATA_ATTR DelaySlot slots[DELAY_MODEL_SLOTS];
+
+static uint32_t fnv1a(uint32_t hash, const char* text) {
+    while (*text) {
+        hash ^= (uint8_t)*text++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+DelayModel::DelayModel() {
+    observations = 0;
+    estimates = 0;
+}
+
+void DelayModel::init() {
+    if (tableMagic != DELAY_MODEL_MAGIC) {
+        memset(slots, 0, sizeof(slots));
+        tableMagic = DELAY_MODEL_MAGIC;
+    }
+    DEBUG_PRINTF("Delay model: %d trained slot(s) carried over\n", getTrainedSlots());
+}
+
+uint32_t DelayModel::keyFor(const char* route, const char* stop, int aimedMinuteOfDay) {
+    int minute = ((aimedMinuteOfDay % 1440) + 1440) % 1440;
+    uint8_t bucket = minute / DELAY_MODEL_BUCKET_MINUTES;
+
+    // Weekend traffic runs differently - give it its own buckets, by the
+    // day the bus is aimed at (a late Friday bus seen after midnight is Friday's)
+    const ClockSnapshot& clock = clockService.now();
+    if (clock.valid) {
+        int dayOffset = (aimedMinuteOfDay - minute) / 1440;
+        int dayOfWeek = ((clock.dayOfWeek + dayOffset) % 7 + 7) % 7;
+        if (dayOfWeek == 0 || dayOfWeek == 6) bucket |= 0x80;
+    }
+
+    uint32_t hash = fnv1a(2166136261u, route);
+    hash = fnv1a(hash ^ 0xFF, stop);
+    hash = (hash ^ bucket) * 16777619u;
+    return hash ? hash : 1;
+}
+
+int DelayModel::findSlot(uint32_t key) const {
+    for (int i = 0; i < DELAY_MODEL_SLOTS; i++) {
+        if (slots[i].key == key) return i;
+    }
+    return -1;
+}
+
+void DelayModel::observe(const char* route, const char* stop, int aimedMinuteOfDay, int delayMinutes) {
+    // A bus an hour out is a cancellation or a data error, not a delay
+    if (delayMinutes > DELAY_MODEL_MAX_MINUTES || delayMinutes < -DELAY_MODEL_MAX_MINUTES) return;
+
+    uint32_t key = keyFor(route, stop, aimedMinuteOfDay);
+    int index = findSlot(key);
+
+    if (index < 0) {
+        // Recycle a free slot, otherwise the stalest one with the fewest samples
+        index = 0;
+        for (int i = 0; i < DELAY_MODEL_SLOTS; i++) {
+            if (slots[i].key == 0) { index = i; break; }
+            int score = slots[i].age - slots[i].samples;
+            int best = slots[index].age - slots[index].samples;
+            if (score > best) index = i;
+        }
+        slots[index].key = key;
+        slots[index].delay16 = delayMinutes * 16;
+        slots[index].samples = 0;
+    }
+
+    for (int i = 0; i < DELAY_MODEL_SLOTS; i++) {
+        if (slots[i].key != 0 && slots[i].age < 255) slots[i].age++;
+    }
+
+    DelaySlot& slot = slots[index];
+    // Exponential average - a new slot tracks fast, a trained one settles
+    int shift = slot.samples < 4 ? 1 : DELAY_MODEL_WEIGHT_SHIFT;
+    int target = delayMinutes * 16;
+    slot.delay16 += (target - slot.delay16) / (1 << shift);
+    if (slot.samples < 255) slot.samples++;
+    slot.age = 0;
+    observations++;
+}
+
+bool DelayModel::estimate(const char* route, const char* stop, int aimedMinuteOfDay, int& delayMinutes) const {
+    int index = findSlot(keyFor(route, stop, aimedMinuteOfDay));
+    if (index < 0 || slots[index].samples < DELAY_MODEL_MIN_SAMPLES) return false;
+
+    int delay16 = slots[index].delay16;
+    delayMinutes = (delay16 >= 0 ? delay16 + 8 : delay16 - 8) / 16;  // Round to nearest
+    estimates++;
+    return true;
+}
+
+int DelayModel::getTrainedSlots() const {
+    int trained = 0;
+    for (int i = 0; i < DELAY_MODEL_SLOTS; i++) {
+        if (slots[i].key != 0 && slots[i].samples >= DELAY_MODEL_MIN_SAMPLES) trained++;
+    }
+    return trained;
+}
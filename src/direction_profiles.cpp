@@ -0,0 +1,75 @@
+#include "direction_profiles.h"
+#include "service_hours.h"
+
+// ============================================================================
+// DIRECTION PROFILES IMPLEMENTATION
+// ============================================================================
+
+DirectionScheduler directionSchedule;
+
+const DirectionProfile DirectionScheduler::profiles[] = { DIRECTION_PROFILES };
+const int DirectionScheduler::profileCount = sizeof(profiles) / sizeof(profiles[0]);
+
+DirectionScheduler::DirectionScheduler() {
+    currentIndex = -1;
+    overridden = false;
+}
+
+bool DirectionScheduler::update(int minuteOfDay) {
+    // Latest start at or before now; before the first start the last one
+    // is still running from yesterday
+    int index = profileCount - 1;
+    for (int i = 0; i < profileCount; i++) {
+        if (profiles[i].startMinute <= minuteOfDay) index = i;
+    }
+    if (index == currentIndex) return false;
+
+    currentIndex = index;
+    overridden = false;
+    return true;
+}
+
+const DirectionProfile* DirectionScheduler::current() const {
+    return currentIndex >= 0 ? &profiles[currentIndex] : nullptr;
+}
+
+void DirectionScheduler::overrideDirection() {
+    overridden = true;
+}
+
+int DirectionScheduler::remainingCalls(int apiCallsToday) const {
+    if (currentIndex < 0) return API_DAILY_LIMIT - apiCallsToday;
+
+    // Everything earlier profiles left unspent is available too
+    float share = 0;
+    for (int i = 0; i <= currentIndex; i++) share += profiles[i].budgetShare;
+    int allowed = (int)(API_DAILY_LIMIT * min(share, 1.0f));
+    return allowed - apiCallsToday;
+}
+
+int DirectionScheduler::minutesLeft(int minuteOfDay) const {
+    int start, end;
+    serviceHours.today(start, end);
+    if (currentIndex >= 0 && currentIndex + 1 < profileCount) {
+        end = min(end, profiles[currentIndex + 1].startMinute);
+    }
+    return max(end - minuteOfDay, 0);
+}
+
+int DirectionScheduler::stopsPerRefresh(int directionStopCount) const {
+    const DirectionProfile* profile = current();
+    if (profile == nullptr || overridden) return directionStopCount;
+
+    int stops = 0;
+    for (int i = 0; i < directionStopCount; i++) {
+        if (profile->stopMask & (1 << i)) stops++;
+    }
+    return max(stops, 1);
+}
+
+uint8_t DirectionScheduler::stopMaskFor(Direction dir) const {
+    for (int i = 0; i < profileCount; i++) {
+        if (profiles[i].direction == dir) return profiles[i].stopMask;
+    }
+    return 0xFF;
+}
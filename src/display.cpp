@@ -1,11 +1,11 @@
 #include "display.h"
 #include "epd_driver.h"
-#include "esp_heap_caps.h"
+#include "mem_policy.h"
 #include "firasans.h"
+#include "clock_service.h"
 #include "busstop_font.h"
 #include "busstop_small_font.h"
 #include <time.h>
-#include <vector>
 #include <cmath>
 #include "zlib/zlib.h"
 
@@ -22,10 +22,11 @@ static const int HERO_WIDTH = EPD_WIDTH - (SCREEN_MARGIN * 2);
 static const int HERO_INNER_WIDTH = HERO_WIDTH - (HERO_CONTENT_PADDING * 2);
 static const int HERO_TIME_WIDTH = 140;
 static const int HERO_BATTERY_WIDTH = 140;
-static const int HERO_DIRECTION_WIDTH = HERO_INNER_WIDTH - HERO_TIME_WIDTH - HERO_BATTERY_WIDTH - (HERO_COLUMN_GAP * 2);
+static const int HERO_WEATHER_WIDTH = 240;
+static const int HERO_DIRECTION_WIDTH = HERO_INNER_WIDTH - HERO_TIME_WIDTH - HERO_WEATHER_WIDTH - HERO_BATTERY_WIDTH - (HERO_COLUMN_GAP * 3);
 static const float HERO_FONT_SCALE = 0.8f;
 static const float RIGHT_COLUMN_SCALE = 0.78f;
-static const int CARD_MAX_COUNT = 3;
+static const int CARD_MAX_COUNT = RENDER_MAX_DEPARTURES;  // Also sizes the render queue entries
 static const int MIN_CARD_COUNT = 3;
 static const int CARD_SPACING = 12;
 static const int CARD_STACK_TOP = SCREEN_MARGIN + HERO_HEIGHT + SCREEN_MARGIN;
@@ -50,6 +51,7 @@ enum LayoutRegion {
     LAYOUT_HERO,
     LAYOUT_HERO_TIME,
     LAYOUT_HERO_DIRECTION,
+    LAYOUT_HERO_WEATHER,
     LAYOUT_HERO_BATTERY,
     LAYOUT_CARD_STACK,
     LAYOUT_COUNT
@@ -72,9 +74,14 @@ static const LayoutSlot kLayoutTable[LAYOUT_COUNT] = {
         SCREEN_MARGIN + HERO_CONTENT_PADDING + HERO_TIME_WIDTH + HERO_COLUMN_GAP,
         SCREEN_MARGIN,
         HERO_DIRECTION_WIDTH, HERO_HEIGHT},
-    {LAYOUT_HERO_BATTERY, "Hero battery",
+    {LAYOUT_HERO_WEATHER, "Hero weather",
         SCREEN_MARGIN + HERO_CONTENT_PADDING + HERO_TIME_WIDTH + HERO_COLUMN_GAP + HERO_DIRECTION_WIDTH + HERO_COLUMN_GAP,
         SCREEN_MARGIN,
+        HERO_WEATHER_WIDTH, HERO_HEIGHT},
+    {LAYOUT_HERO_BATTERY, "Hero battery",
+        SCREEN_MARGIN + HERO_CONTENT_PADDING + HERO_TIME_WIDTH + HERO_COLUMN_GAP + HERO_DIRECTION_WIDTH + HERO_COLUMN_GAP +
+        HERO_WEATHER_WIDTH + HERO_COLUMN_GAP,
+        SCREEN_MARGIN,
         HERO_BATTERY_WIDTH, HERO_HEIGHT},
     {LAYOUT_CARD_STACK, "Card stack", SCREEN_MARGIN, CARD_STACK_TOP, HERO_WIDTH, CARD_STACK_HEIGHT}
 };
@@ -89,11 +96,11 @@ static const LayoutSlot& layoutSlot(LayoutRegion id) {
 int DisplayManager::calculateLeaveIn(const BusDeparture& dep) const {
     int minutesUntil = dep.minutesUntilDeparture;  // fallback
     if (dep.departureTime.length() >= 5) {
-        struct tm timeinfo;
-        if (getLocalTime(&timeinfo)) {
+        const ClockSnapshot& clock = clockService.now();
+        if (clock.valid) {
             int depHour = dep.departureTime.substring(0, 2).toInt();
             int depMin = dep.departureTime.substring(3, 5).toInt();
-            int nowMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+            int nowMinutes = clock.minuteOfDay;
             int depMinutes = depHour * 60 + depMin;
             if (depMinutes < nowMinutes - 60) depMinutes += 24 * 60;  // overnight
             minutesUntil = depMinutes - nowMinutes;
@@ -112,9 +119,14 @@ DisplayManager::DisplayManager() {
     placeholderYOffset = 0;
     lastTimeStr = "";
     lastBatteryPercent = -1;
+    weatherLabel[0] = '\0';
+    timetableOnScreen = false;
     loadingLogActive = false;
     loadingLogCursorY = SCREEN_MARGIN + 40;
     colorsInverted = false;
+    clearCycles = 2;
+    pendingCount = 0;
+    updateDepth = 0;
     for (int i = 0; i < CARD_MAX_COUNT; i++) lastLeaveIn[i] = -999;
 }
 
@@ -122,11 +134,14 @@ void DisplayManager::setInvertedColors(bool inverted) {
     colorsInverted = inverted;
 }
 
+void DisplayManager::setClearCycles(int cycles) {
+    clearCycles = cycles;
+}
+
 void DisplayManager::init() {
     if (initialized) return;
     epd_init();
-    frameBuffer = (uint8_t*)heap_caps_malloc(EPD_WIDTH * EPD_HEIGHT / 2, MALLOC_CAP_SPIRAM);
-    if (!frameBuffer) frameBuffer = (uint8_t*)malloc(EPD_WIDTH * EPD_HEIGHT / 2);
+    frameBuffer = (uint8_t*)memPolicy.allocate(EPD_WIDTH * EPD_HEIGHT / 2, MEM_BULK);
     if (!frameBuffer) { DEBUG_PRINTLN("FATAL: No buffer"); return; }
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
     initialized = true;
@@ -136,19 +151,16 @@ void DisplayManager::init() {
 
 void DisplayManager::clear() {
     if (!initialized) return;
-    epd_poweron(); epd_clear(); epd_poweroff_all();
-    sleep();  // Ensure display sleeps after clear
+    pushArea(epd_full_screen(), CLEAR_DEFAULT, false);
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
     partialRefreshCount = 0;
+    timetableOnScreen = false;
     lastFullRefresh = millis();
 }
 
 void DisplayManager::fullRefresh() {
     if (!initialized) return;
-    epd_poweron(); epd_clear();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display is fully powered off
+    pushArea(epd_full_screen(), CLEAR_DEFAULT);
     partialRefreshCount = 0;
     lastFullRefresh = millis();
 }
@@ -157,19 +169,13 @@ void DisplayManager::partialRefresh(ScreenRegion r) {
     if (!initialized) return;
     if (needsFullRefresh()) { fullRefresh(); return; }
     Rect_t a = {r.x, r.y, r.width, r.height};
-    epd_poweron();
-    epd_draw_grayscale_image(a, frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(a, CLEAR_NONE);
     partialRefreshCount++;
 }
 
 void DisplayManager::fastRefresh() {
     if (!initialized) return;
-    epd_poweron();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_NONE);
     partialRefreshCount++;
 }
 
@@ -197,13 +203,13 @@ void DisplayManager::showBusTimetable(BusDeparture departures[], int count,
     
     // Background color depends on inversion state
     uint8_t bgColor = colorsInverted ? 0xFF : 0x33;  // Light or dark
-    uint8_t headerBg = colorsInverted ? 240 : 50;
     memset(frameBuffer, bgColor, EPD_WIDTH * EPD_HEIGHT / 2);
     logLayoutTable();
     
     char dateBuf[32] = "--";
-    struct tm timeinfo;
-    bool haveLocalTime = getLocalTime(&timeinfo);
+    const ClockSnapshot& clock = clockService.now();
+    const struct tm& timeinfo = clock.local;
+    bool haveLocalTime = clock.valid;
     if (haveLocalTime) {
         strftime(dateBuf, sizeof(dateBuf), "%A %d %b", &timeinfo);
     }
@@ -216,58 +222,7 @@ void DisplayManager::showBusTimetable(BusDeparture departures[], int count,
     }
     
     // ===== HERO HEADER =====
-    const LayoutSlot& heroRect = layoutSlot(LAYOUT_HERO);
-    const LayoutSlot& heroBatteryRect = layoutSlot(LAYOUT_HERO_BATTERY);
-    
-    // Header background
-    epd_fill_rect(heroRect.x, heroRect.y, heroRect.width, heroRect.height, headerBg, frameBuffer);
-    
-    // Text properties depend on inversion
-    FontProperties textProps = {
-        .fg_color = colorsInverted ? (uint8_t)0 : (uint8_t)15,  // Black or white
-        .bg_color = colorsInverted ? (uint8_t)15 : (uint8_t)3,
-        .fallback_glyph = 0,
-        .flags = 0
-    };
-    
-    // Time on left
-    int32_t hx = heroRect.x + 20;
-    int32_t hy = heroRect.y + 42;
-    if (colorsInverted) {
-        writeln((GFXfont*)&BusStop, timeLabel.c_str(), &hx, &hy, frameBuffer);
-    } else {
-        write_mode((GFXfont*)&BusStop, timeLabel.c_str(), &hx, &hy, frameBuffer, BLACK_ON_WHITE, &textProps);
-    }
-    
-    // Direction centered
-    String dirLine = direction.length() ? direction : "Departures";
-    int dirWidth = getTextWidth(dirLine, &BusStop);
-    int32_t dx = heroRect.x + (heroRect.width - dirWidth) / 2;
-    int32_t dy = heroRect.y + 42;
-    if (colorsInverted) {
-        writeln((GFXfont*)&BusStop, dirLine.c_str(), &dx, &dy, frameBuffer);
-    } else {
-        write_mode((GFXfont*)&BusStop, dirLine.c_str(), &dx, &dy, frameBuffer, BLACK_ON_WHITE, &textProps);
-    }
-    
-    // Battery as ASCII only: [|||||] or [|||  ]
-    int bars = (batteryPercent + 10) / 20;  // 0-5 bars
-    if (bars > 5) bars = 5;
-    if (bars < 0) bars = 0;
-    String batStr = "[";
-    for (int i = 0; i < 5; i++) {
-        batStr += (i < bars) ? "|" : " ";
-    }
-    batStr += "]";
-    
-    int batWidth = getTextWidth(batStr, &BusStop);
-    int32_t batX = heroBatteryRect.x + heroBatteryRect.width - batWidth - 10;
-    int32_t batY = heroRect.y + 42;
-    if (colorsInverted) {
-        writeln((GFXfont*)&BusStop, batStr.c_str(), &batX, &batY, frameBuffer);
-    } else {
-        write_mode((GFXfont*)&BusStop, batStr.c_str(), &batX, &batY, frameBuffer, BLACK_ON_WHITE, &textProps);
-    }
+    drawHeader(timeLabel, direction, batteryPercent, wifiConnected);
     
     // ===== BUS CARDS =====
     const LayoutSlot& cardsArea = layoutSlot(LAYOUT_CARD_STACK);
@@ -306,17 +261,38 @@ void DisplayManager::showBusTimetable(BusDeparture departures[], int count,
         }
     }
     
-    // Always do full refresh
-    epd_poweron();
-    Rect_t fullScreen = {0, 0, EPD_WIDTH, EPD_HEIGHT};
-    epd_clear_area_cycles(fullScreen, 2, 40);
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    // Always do full refresh - drawing only darkens pixels, so at least one
+    // clear pass is needed or new digits land on the old ones. The power
+    // policy may cut it to one pass; the full two still run once per interval
+    // to clear ghosting
+    int cycles = max(clearCycles, 1);
+    if (millis() - lastFullRefresh > DISPLAY_FULL_REFRESH_INTERVAL) {
+        cycles = max(cycles, 2);
+    }
+    if (cycles >= 2) {
+        lastFullRefresh = millis();
+    }
+    pushArea(epd_full_screen(), cycles);
     DEBUG_PRINTLN("Display: Full refresh");
     
     lastTimeStr = timeLabel;
+    lastDirection = direction;
     lastBatteryPercent = batteryPercent;
+    timetableOnScreen = true;
+}
+
+void DisplayManager::setWeather(const char* label) {
+    if (strcmp(label, weatherLabel) == 0) return;
+    strlcpy(weatherLabel, label, sizeof(weatherLabel));
+    
+    // Off screen: the next timetable render picks the label up
+    if (!initialized || !frameBuffer || !timetableOnScreen) return;
+    
+    // Only the hero header changed - redraw and push just that region
+    drawHeader(lastTimeStr, lastDirection, lastBatteryPercent, true);
+    const LayoutSlot& heroRect = layoutSlot(LAYOUT_HERO);
+    pushRegionToDisplay({heroRect.x, heroRect.y, heroRect.width, heroRect.height}, UPDATE_MODE_FULL);
+    DEBUG_PRINTF("Display: Weather header update (%s)\n", weatherLabel[0] ? weatherLabel : "hidden");
 }
 
 void DisplayManager::logLayoutTable() const {
@@ -475,7 +451,10 @@ void DisplayManager::drawScaledTextInRect(int left, int top, int width, int heig
 void DisplayManager::drawScaledGlyphRun(const String& text, int startX, int baselineY, float scale) {
     if (!frameBuffer) return;
     const GFXfont* font = (GFXfont*)&BusStop;
-    std::vector<uint8_t> scratch;
+    // Decompressed glyphs are read per pixel, so they stay in internal RAM.
+    // The buffer only ever grows, to the largest glyph drawn so far.
+    static uint8_t* scratch = nullptr;
+    static size_t scratchSize = 0;
     int cursorX = startX;
     const char* raw = text.c_str();
     while (*raw) {
@@ -486,15 +465,19 @@ void DisplayManager::drawScaledGlyphRun(const String& text, int startX, int base
         int byteWidth = (glyph->width / 2) + (glyph->width & 1);
         size_t bitmapSize = byteWidth * glyph->height;
         const uint8_t* bitmap = font->bitmap + glyph->data_offset;
-        scratch.clear();
         if (font->compressed && bitmapSize > 0) {
-            scratch.resize(bitmapSize);
+            if (bitmapSize > scratchSize) {
+                uint8_t* grown = (uint8_t*)memPolicy.reallocate(scratch, bitmapSize, MEM_HOT);
+                if (!grown) return;
+                scratch = grown;
+                scratchSize = bitmapSize;
+            }
             uLongf destLen = bitmapSize;
-            if (uncompress(scratch.data(), &destLen, font->bitmap + glyph->data_offset, glyph->compressed_size) != Z_OK) {
+            if (uncompress(scratch, &destLen, font->bitmap + glyph->data_offset, glyph->compressed_size) != Z_OK) {
                 cursorX += max(1, (int)ceil(glyph->advance_x * scale));
                 continue;
             }
-            bitmap = scratch.data();
+            bitmap = scratch;
         }
         drawScaledGlyph(glyph, bitmap, byteWidth, cursorX, baselineY, scale);
         cursorX += max(1, (int)ceil(glyph->advance_x * scale));
@@ -544,19 +527,18 @@ void DisplayManager::updateFooter(int, bool) {}
 void DisplayManager::showError(const String& msg) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
     int32_t x = 300, y = 270;
     writeln((GFXfont*)&BusStop, "Error", &x, &y, frameBuffer);
     x = 200; y = 320;
     writeln((GFXfont*)&BusStop, msg.c_str(), &x, &y, frameBuffer);
-    epd_poweron(); epd_clear();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_DEFAULT);
 }
 
 void DisplayManager::showLoading(const String& msg) {
     if (!initialized || !frameBuffer) return;
+    timetableOnScreen = false;
     const GFXfont* font = (GFXfont*)&BusStop;
     int lineHeight = getTextHeight(font) + 8;
     if (!loadingLogActive || (loadingLogCursorY + lineHeight > EPD_HEIGHT - SCREEN_MARGIN)) {
@@ -574,15 +556,13 @@ void DisplayManager::showLoading(const String& msg) {
     writeln((GFXfont*)font, line.c_str(), &x, &y, frameBuffer);
     loadingLogCursorY = y + lineHeight;
     
-    epd_poweron();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_NONE);
 }
 
 void DisplayManager::showOtaProgress(const String& message, int progressPercent) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     
     static String lastMessage = "";
     static int lastProgress = -1;
@@ -685,12 +665,7 @@ void DisplayManager::showOtaProgress(const String& message, int progressPercent)
     
     // ALWAYS use full refresh to avoid ghosting and black boxes
     // E-ink displays need full clears for clean updates
-    epd_poweron();
-    Rect_t fullScreen = {0, 0, EPD_WIDTH, EPD_HEIGHT};
-    epd_clear_area_cycles(fullScreen, 2, 40);
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();
+    pushArea(epd_full_screen(), 2);
     resetFullRefreshTimer();
     
     lastMessage = message;
@@ -700,18 +675,17 @@ void DisplayManager::showOtaProgress(const String& message, int progressPercent)
 void DisplayManager::showNoData(const String& msg) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
     int32_t x = 350, y = 270;
     writeln((GFXfont*)&BusStop, "No Data", &x, &y, frameBuffer);
-    epd_poweron(); epd_clear();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_DEFAULT);
 }
 
 void DisplayManager::showWiFiSetup(const String& ssid, const String& ip) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     
     // White background
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
@@ -762,17 +736,13 @@ void DisplayManager::showWiFiSetup(const String& ssid, const String& ip) {
     writeln(font, line3.c_str(), &x, &y, frameBuffer);
     
     // Refresh display
-    epd_poweron();
-    Rect_t fullScreen = {0, 0, EPD_WIDTH, EPD_HEIGHT};
-    epd_clear_area_cycles(fullScreen, 2, 40);
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), 2);
 }
 
 void DisplayManager::showClock(const String& timeStr) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     
     // Clear to white
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
@@ -780,8 +750,9 @@ void DisplayManager::showClock(const String& timeStr) {
     // Get current date
     char dateBuf[64] = "";
     char dayBuf[32] = "";
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo)) {
+    const ClockSnapshot& clock = clockService.now();
+    if (clock.valid) {
+        const struct tm& timeinfo = clock.local;
         strftime(dayBuf, sizeof(dayBuf), "%A", &timeinfo);  // "Friday"
         strftime(dateBuf, sizeof(dateBuf), "%d %B %Y", &timeinfo);  // "05 December 2024"
     }
@@ -840,31 +811,25 @@ void DisplayManager::showClock(const String& timeStr) {
     write_mode((GFXfont*)&BusStop, sleepText, &sleepX, &sleepY, frameBuffer, BLACK_ON_WHITE, &grayText);
     
     // Full refresh for clean display
-    epd_poweron();
-    epd_clear();
-    delay(50);
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_DEFAULT);
 }
 
 void DisplayManager::showLowBattery(int pct) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
     char buf[32];
     snprintf(buf, sizeof(buf), "Low Battery: %d%%", pct);
     int32_t x = 300, y = 270;
     writeln((GFXfont*)&BusStop, buf, &x, &y, frameBuffer);
-    epd_poweron(); epd_clear();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_DEFAULT);
 }
 
 void DisplayManager::showConnectionStatus(bool wifi, bool mqtt) {
     if (!initialized || !frameBuffer) return;
     resetLoadingLog();
+    timetableOnScreen = false;
     memset(frameBuffer, 0xFF, EPD_WIDTH * EPD_HEIGHT / 2);
     int32_t x = 350, y = 250;
     writeln((GFXfont*)&BusStop, "Status", &x, &y, frameBuffer);
@@ -872,10 +837,7 @@ void DisplayManager::showConnectionStatus(bool wifi, bool mqtt) {
     writeln((GFXfont*)&BusStop, wifi ? "WiFi: OK" : "WiFi: FAIL", &x, &y, frameBuffer);
     x = 300; y = 340;
     writeln((GFXfont*)&BusStop, mqtt ? "MQTT: OK" : "MQTT: FAIL", &x, &y, frameBuffer);
-    epd_poweron(); epd_clear();
-    epd_draw_grayscale_image(epd_full_screen(), frameBuffer);
-    epd_poweroff_all();
-    sleep();  // Ensure display sleeps after refresh
+    pushArea(epd_full_screen(), CLEAR_DEFAULT);
 }
 
 void DisplayManager::updateTimeOnly(const String&) {}
@@ -1002,11 +964,98 @@ int DisplayManager::drawWrappedTextBlock(int left, int top, int width, int maxHe
 }
 void DisplayManager::pushRegionToDisplay(ScreenRegion r, UpdateMode m) {
     Rect_t a = {r.x, r.y, r.width, r.height};
+    pushArea(a, m == UPDATE_MODE_FULL ? CLEAR_DEFAULT : CLEAR_NONE);
+}
+
+void DisplayManager::beginUpdate() {
+    updateDepth++;
+}
+
+void DisplayManager::queueRegion(ScreenRegion region, UpdateMode mode) {
+    if (!initialized) return;
+    pushRegionToDisplay(region, mode);
+}
+
+void DisplayManager::mergeBand(PendingBand& into, const PendingBand& band) {
+    into.top = min(into.top, band.top);
+    into.bottom = max(into.bottom, band.bottom);
+    // A full clear beats a cycle count, otherwise the longer clear wins
+    if (into.clearCycles == CLEAR_DEFAULT || band.clearCycles == CLEAR_DEFAULT) {
+        into.clearCycles = CLEAR_DEFAULT;
+    } else {
+        into.clearCycles = max(into.clearCycles, band.clearCycles);
+    }
+    // The framebuffer already holds the final image, so drawing over a
+    // clear-only band just redraws white
+    into.draw = into.draw || band.draw;
+}
+
+void DisplayManager::pushArea(Rect_t area, int clearCycles, bool draw) {
+    Rect_t a = clampToScreen(area);
+    if (a.height <= 0) return;
+
+    PendingBand band = {a.y, a.y + a.height, clearCycles, draw};
+
+    // Fold into every band it touches - overlapping waveforms on the same
+    // rows would otherwise be driven twice
+    for (int i = 0; i < pendingCount; ) {
+        if (band.top <= pending[i].bottom && pending[i].top <= band.bottom) {
+            mergeBand(band, pending[i]);
+            pending[i] = pending[--pendingCount];
+        } else {
+            i++;
+        }
+    }
+    if (pendingCount == DISPLAY_MAX_PENDING_AREAS) {
+        for (int i = 0; i < pendingCount; i++) mergeBand(band, pending[i]);
+        pendingCount = 0;
+    }
+    pending[pendingCount++] = band;
+
+    if (updateDepth == 0) {
+        updateDepth = 1;
+        commitUpdate();
+    }
+}
+
+void DisplayManager::commitUpdate() {
+    if (updateDepth > 0) updateDepth--;
+    if (updateDepth > 0 || pendingCount == 0) return;
+
+    // Top to bottom, so the panel scans each row range once per phase
+    for (int i = 1; i < pendingCount; i++) {
+        PendingBand band = pending[i];
+        int j = i - 1;
+        while (j >= 0 && pending[j].top > band.top) {
+            pending[j + 1] = pending[j];
+            j--;
+        }
+        pending[j + 1] = band;
+    }
+
     epd_poweron();
-    if (m == UPDATE_MODE_FULL) epd_clear_area(a);
-    epd_draw_grayscale_image(a, frameBuffer);
+    // Every clear first, then every draw - a draw never gets washed out by a
+    // later band's clear
+    for (int i = 0; i < pendingCount; i++) {
+        const PendingBand& band = pending[i];
+        Rect_t rows = {0, band.top, EPD_WIDTH, band.bottom - band.top};
+        if (band.clearCycles == CLEAR_DEFAULT) {
+            epd_clear_area(rows);
+        } else if (band.clearCycles > 0) {
+            epd_clear_area_cycles(rows, band.clearCycles, 40);
+        }
+    }
+    for (int i = 0; i < pendingCount; i++) {
+        const PendingBand& band = pending[i];
+        if (!band.draw) continue;
+        Rect_t rows = {0, band.top, EPD_WIDTH, band.bottom - band.top};
+        epd_draw_grayscale_image(rows, frameBuffer + band.top * EPD_WIDTH / 2);
+    }
     epd_poweroff_all();
     sleep();  // Ensure display sleeps after refresh
+
+    DEBUG_PRINTF("Display: %d band(s) in one power cycle\n", pendingCount);
+    pendingCount = 0;
 }
 
 void DisplayManager::sleep() {
@@ -1042,7 +1091,85 @@ Rect_t DisplayManager::clampToScreen(Rect_t rect) const {
     return r;
 }
 
-void DisplayManager::drawHeader(const String&, const String&, int, bool) {}
+void DisplayManager::drawHeader(const String& currentTime, const String& direction,
+                                int batteryPercent, bool) {
+    const LayoutSlot& heroRect = layoutSlot(LAYOUT_HERO);
+    const LayoutSlot& heroDirectionRect = layoutSlot(LAYOUT_HERO_DIRECTION);
+    const LayoutSlot& heroWeatherRect = layoutSlot(LAYOUT_HERO_WEATHER);
+    const LayoutSlot& heroBatteryRect = layoutSlot(LAYOUT_HERO_BATTERY);
+    uint8_t headerBg = colorsInverted ? 240 : 50;
+    
+    // Header background
+    epd_fill_rect(heroRect.x, heroRect.y, heroRect.width, heroRect.height, headerBg, frameBuffer);
+    
+    // Text properties depend on inversion
+    FontProperties textProps = {
+        .fg_color = colorsInverted ? (uint8_t)0 : (uint8_t)15,  // Black or white
+        .bg_color = colorsInverted ? (uint8_t)15 : (uint8_t)3,
+        .fallback_glyph = 0,
+        .flags = 0
+    };
+    
+    // Time on left
+    int32_t hx = heroRect.x + 20;
+    int32_t hy = heroRect.y + 42;
+    if (colorsInverted) {
+        writeln((GFXfont*)&BusStop, currentTime.c_str(), &hx, &hy, frameBuffer);
+    } else {
+        write_mode((GFXfont*)&BusStop, currentTime.c_str(), &hx, &hy, frameBuffer, BLACK_ON_WHITE, &textProps);
+    }
+    
+    // Direction centered (in its own column when weather shares the header)
+    String dirLine = direction.length() ? direction : "Departures";
+    int dirWidth = getTextWidth(dirLine, &BusStop);
+    int32_t dx = heroRect.x + (heroRect.width - dirWidth) / 2;
+    if (weatherLabel[0]) {
+        dx = heroDirectionRect.x + (heroDirectionRect.width - dirWidth) / 2;
+    }
+    int32_t dy = heroRect.y + 42;
+    if (colorsInverted) {
+        writeln((GFXfont*)&BusStop, dirLine.c_str(), &dx, &dy, frameBuffer);
+    } else {
+        write_mode((GFXfont*)&BusStop, dirLine.c_str(), &dx, &dy, frameBuffer, BLACK_ON_WHITE, &textProps);
+    }
+    
+    // Weather, right-aligned in its column; drop the condition if it won't fit
+    if (weatherLabel[0]) {
+        String weatherLine = weatherLabel;
+        int weatherWidth = getTextWidth(weatherLine, &BusStopSmall);
+        if (weatherWidth > heroWeatherRect.width) {
+            int space = weatherLine.indexOf(' ');
+            if (space > 0) weatherLine = weatherLine.substring(0, space);
+            weatherWidth = getTextWidth(weatherLine, &BusStopSmall);
+        }
+        int32_t wx = heroWeatherRect.x + heroWeatherRect.width - weatherWidth;
+        int32_t wy = heroRect.y + 40;
+        if (colorsInverted) {
+            writeln((GFXfont*)&BusStopSmall, weatherLine.c_str(), &wx, &wy, frameBuffer);
+        } else {
+            write_mode((GFXfont*)&BusStopSmall, weatherLine.c_str(), &wx, &wy, frameBuffer, BLACK_ON_WHITE, &textProps);
+        }
+    }
+    
+    // Battery as ASCII only: [|||||] or [|||  ]
+    int bars = (batteryPercent + 10) / 20;  // 0-5 bars
+    if (bars > 5) bars = 5;
+    if (bars < 0) bars = 0;
+    String batStr = "[";
+    for (int i = 0; i < 5; i++) {
+        batStr += (i < bars) ? "|" : " ";
+    }
+    batStr += "]";
+    
+    int batWidth = getTextWidth(batStr, &BusStop);
+    int32_t batX = heroBatteryRect.x + heroBatteryRect.width - batWidth - 10;
+    int32_t batY = heroRect.y + 42;
+    if (colorsInverted) {
+        writeln((GFXfont*)&BusStop, batStr.c_str(), &batX, &batY, frameBuffer);
+    } else {
+        write_mode((GFXfont*)&BusStop, batStr.c_str(), &batX, &batY, frameBuffer, BLACK_ON_WHITE, &textProps);
+    }
+}
 void DisplayManager::drawStatusBar(int, bool) {}
 void DisplayManager::drawBatteryIcon(int x, int y, int percent) {
     if (!frameBuffer) return;
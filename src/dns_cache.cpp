@@ -0,0 +1,228 @@
+#include "dns_cache.h"
+#include <WiFi.h>
+#include <esp_attr.h>
+#include <time.h>
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+
+// ============================================================================
+// DNS CACHE IMPLEMENTATION
+// ============================================================================
+
+DnsCache dnsCache;
+
+static const uint32_t DNS_CACHE_MAGIC = 0xD45CAC4E;
+
+struct DnsEntry {
+    char host[48];
+    uint32_t ip;            // 0 = not resolved
+    uint32_t resolvedAt;    // time() when resolved - keeps counting through deep sleep
+};
+
+// RTC slow memory keeps this across deep sleep; light sleep keeps all RAM
+static RTC_DATA_ATTR uint32_t tableMagic;
+static RTC_DATA_ATTR DnsEntry entries[DNS_CACHE_SIZE];
+
+// Asynchronous lookup bookkeeping (the callback runs on the lwIP task)
+enum LookupState : uint8_t { LOOKUP_IDLE, LOOKUP_PENDING, LOOKUP_DONE, LOOKUP_FAILED };
+static volatile uint8_t lookupState[DNS_CACHE_SIZE];
+static volatile uint32_t lookupResult[DNS_CACHE_SIZE];
+static uint32_t lastAttempt[DNS_CACHE_SIZE];
+
+static void onLookupDone(const char* name, const ip_addr_t* ipaddr, void* arg) {
+    int index = (int)(intptr_t)arg;
+    if (index < 0 || index >= DNS_CACHE_SIZE) return;
+    if (ipaddr) {
+        lookupResult[index] = ip_2_ip4(ipaddr)->addr;
+        lookupState[index] = LOOKUP_DONE;
+    } else {
+        lookupState[index] = LOOKUP_FAILED;
+    }
+}
+
+// lwIP's raw DNS API is only safe on the tcpip thread, so the lookup is
+// posted there (as WiFi.hostByName does) rather than called from our task
+static void startLookup(void* arg) {
+    int index = (int)(intptr_t)arg;
+    ip_addr_t addr;
+    err_t err = dns_gethostbyname(entries[index].host, &addr, onLookupDone, arg);
+    if (err == ERR_OK) {
+        onLookupDone(entries[index].host, &addr, arg);  // Answered from lwIP's own table
+    } else if (err != ERR_INPROGRESS) {
+        lookupState[index] = LOOKUP_FAILED;
+    }
+}
+
+static uint32_t nowSeconds() {
+    return (uint32_t)time(nullptr);
+}
+
+static bool isStale(const DnsEntry& entry, uint32_t now) {
+    if (entry.ip == 0) return true;
+    if (now < entry.resolvedAt) return true;  // Clock was stepped back
+    return now - entry.resolvedAt >= DNS_CACHE_TTL_S - DNS_REFRESH_AHEAD_S;
+}
+
+DnsCache::DnsCache() {
+    hits = 0;
+    misses = 0;
+}
+
+void DnsCache::init() {
+    if (tableMagic != DNS_CACHE_MAGIC) {
+        memset(entries, 0, sizeof(entries));
+        tableMagic = DNS_CACHE_MAGIC;
+    }
+
+    #if USE_NEXTBUS_API
+    addEntry(NEXTBUS_API_HOST);
+    #else
+    addEntry(TRANSPORT_API_HOST);
+    #endif
+    addEntry(OTA_GITHUB_API_HOST);
+    if (strlen(WEATHER_API_KEY) >= 10) {
+        addEntry(WEATHER_API_HOST);
+    }
+    IPAddress literal;
+    if (!literal.fromString(MQTT_SERVER)) {
+        addEntry(MQTT_SERVER);
+    }
+
+    int cached = 0;
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (entries[i].host[0] && entries[i].ip != 0) cached++;
+    }
+    DEBUG_PRINTF("DNS cache: %d address(es) carried over from before sleep\n", cached);
+}
+
+int DnsCache::findEntry(const char* host) const {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (entries[i].host[0] && strcmp(entries[i].host, host) == 0) return i;
+    }
+    return -1;
+}
+
+int DnsCache::addEntry(const char* host) {
+    int index = findEntry(host);
+    if (index >= 0) return index;
+    if (strlen(host) >= sizeof(entries[0].host)) return -1;
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (!entries[i].host[0]) {
+            strlcpy(entries[i].host, host, sizeof(entries[i].host));
+            entries[i].ip = 0;
+            entries[i].resolvedAt = 0;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void DnsCache::store(int index, uint32_t ip) {
+    entries[index].ip = ip;
+    entries[index].resolvedAt = nowSeconds();
+}
+
+void DnsCache::loop() {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (!entries[i].host[0]) continue;
+
+        if (lookupState[i] == LOOKUP_DONE) {
+            if (lookupResult[i] != entries[i].ip) {
+                DEBUG_PRINTF("DNS cache: %s -> %s\n", entries[i].host,
+                             IPAddress(lookupResult[i]).toString().c_str());
+            }
+            store(i, lookupResult[i]);
+            lookupState[i] = LOOKUP_IDLE;
+        } else if (lookupState[i] == LOOKUP_FAILED) {
+            // Keep serving the old address - it usually still works
+            lookupState[i] = LOOKUP_IDLE;
+        }
+    }
+}
+
+void DnsCache::refresh() {
+    loop();
+    uint32_t now = nowSeconds();
+    unsigned long nowMs = millis();
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (!entries[i].host[0]) continue;
+        if (lookupState[i] != LOOKUP_IDLE || !isStale(entries[i], now)) continue;
+        if (lastAttempt[i] != 0 && nowMs - lastAttempt[i] < DNS_RETRY_S * 1000UL) continue;
+        lastAttempt[i] = nowMs;
+
+        // Asynchronous - answers arrive in onLookupDone and are collected by loop()
+        lookupState[i] = LOOKUP_PENDING;
+        if (tcpip_callback(startLookup, (void*)(intptr_t)i) != ERR_OK) {
+            lookupState[i] = LOOKUP_IDLE;
+        }
+    }
+}
+
+bool DnsCache::resolve(const char* host, IPAddress& ip) {
+    if (ip.fromString(host)) {
+        return true;  // Already an address
+    }
+
+    int index = findEntry(host);
+    if (index >= 0 && entries[index].ip != 0) {
+        hits++;
+        ip = IPAddress(entries[index].ip);
+        return true;
+    }
+
+    // Miss - resolve now and remember it
+    misses++;
+    if (!WiFi.hostByName(host, ip)) {
+        return false;
+    }
+    if (index < 0) index = addEntry(host);
+    if (index >= 0) store(index, (uint32_t)ip);
+    return true;
+}
+
+bool DnsCache::lookup(const char* host, IPAddress& ip) {
+    if (ip.fromString(host)) {
+        return true;  // Already an address
+    }
+    int index = findEntry(host);
+    if (index < 0 || entries[index].ip == 0) return false;
+    hits++;
+    ip = IPAddress(entries[index].ip);
+    return true;
+}
+
+void DnsCache::invalidate(const char* host) {
+    int index = findEntry(host);
+    if (index >= 0) {
+        entries[index].ip = 0;
+    }
+}
+
+bool DnsCache::connect(WiFiClient& client, const char* host, uint16_t port) {
+    if (client.connected()) return true;
+    IPAddress ip;
+    if (!resolve(host, ip)) return false;
+    if (client.connect(ip, port)) return true;
+    invalidate(host);
+    return false;
+}
+
+bool DnsCache::connect(WiFiClientSecure& client, const char* host, uint16_t port) {
+    if (client.connected()) return true;
+    IPAddress ip;
+    if (!resolve(host, ip)) return false;
+    // Pass the host name along for SNI
+    if (client.connect(ip, port, host, nullptr, nullptr, nullptr)) return true;
+    invalidate(host);
+    return false;
+}
+
+int DnsCache::getHitCount() const {
+    return hits;
+}
+
+int DnsCache::getMissCount() const {
+    return misses;
+}
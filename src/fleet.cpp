@@ -0,0 +1,350 @@
+#include "fleet.h"
+#include "mqtt_ha.h"
+#include "clock_service.h"
+#include "net_log.h"
+#include "mem_policy.h"
+#include <ArduinoJson.h>
+
+// ============================================================================
+// FLEET MODE IMPLEMENTATION
+// ============================================================================
+
+FleetCoordinator fleet;
+
+static const char* ROLE_NAMES[] = { "solo", "candidate", "leader", "follower" };
+
+FleetCoordinator::FleetCoordinator() {
+    enabled = false;
+    role = FLEET_SOLO;
+    mqttReady = false;
+    joinedAt = 0;
+    lastLeaderSeen = 0;
+    lastClaim = 0;
+    lastWant = 0;
+    stagger = 0;
+    lastWantDirection = -1;
+    reassertClaim = false;
+    weather[0] = '\0';
+    for (int i = 0; i < 2; i++) {
+        wantSeen[i] = 0;
+        snapshots[i].count = 0;
+        snapshots[i].epoch = 0;
+        snapshots[i].receivedAt = 0;
+        snapshots[i].valid = false;
+        snapshots[i].fresh = false;
+    }
+}
+
+void FleetCoordinator::begin(const String& id) {
+    if (!FLEET_ENABLED) return;
+
+    deviceId = id;
+    enabled = true;
+
+    // Derive the claim offset from the device id so the same device always
+    // waits the same time and two followers rarely claim together
+    uint32_t hash = 5381;
+    for (unsigned int i = 0; i < deviceId.length(); i++) {
+        hash = hash * 33 + deviceId[i];
+    }
+    stagger = hash % FLEET_CLAIM_STAGGER_MS;
+
+    mqtt.addSubscription(FLEET_TOPIC_PREFIX "/#", onMessage);
+    DEBUG_PRINTF("Fleet mode: device %s, claim stagger %lu ms\n", deviceId.c_str(), stagger);
+}
+
+const char* FleetCoordinator::directionKey(Direction dir) {
+    return dir == TO_CHELTENHAM ? "chelt" : "church";
+}
+
+void FleetCoordinator::setRole(FleetRole newRole, const char* reason) {
+    if (newRole == role) return;
+    DEBUG_PRINTF("Fleet: %s -> %s (%s)\n", ROLE_NAMES[role], ROLE_NAMES[newRole], reason);
+    netLog.log(NETLOG_INFO, "fleet %s -> %s (%s)", ROLE_NAMES[role], ROLE_NAMES[newRole], reason);
+    role = newRole;
+}
+
+void FleetCoordinator::loop(bool ready, Direction wantedDirection, bool active) {
+    if (!enabled) return;
+    unsigned long now = millis();
+
+    if (!ready) {
+        // Without the broker we can't hear the leader - fetch locally meanwhile
+        mqttReady = false;
+        return;
+    }
+    if (!mqttReady) {
+        // (Re)joined: retained leader and snapshot messages arrive straight away
+        mqttReady = true;
+        joinedAt = now;
+        if (role == FLEET_SOLO) {
+            setRole(FLEET_CANDIDATE, "joined");
+        }
+    }
+
+    switch (role) {
+        case FLEET_SOLO:
+        case FLEET_CANDIDATE:
+            // A display that isn't showing buses leaves the fetching to one that is
+            if (active && (reassertClaim || now - joinedAt >= FLEET_SETTLE_MS + stagger)) {
+                claim(now);
+                setRole(FLEET_LEADER, "no live leader");
+            }
+            break;
+
+        case FLEET_FOLLOWER:
+            // After a broker reconnect give the retained claim time to arrive
+            if (!active) {
+                // Screen is on the clock - ask for nothing, take over nothing
+                lastWantDirection = -1;
+            } else if (now - lastLeaderSeen >= FLEET_LEASE_MS + stagger &&
+                       now - joinedAt >= FLEET_SETTLE_MS + stagger) {
+                claim(now);
+                setRole(FLEET_LEADER, "lease expired");
+            } else if ((int)wantedDirection != lastWantDirection || now - lastWant >= FLEET_RENEW_MS) {
+                publishWant(wantedDirection, now);
+            }
+            break;
+
+        case FLEET_LEADER:
+            if (!active) {
+                // Outside our own hours or nobody home - hand the fetching over
+                // rather than sit on a lease we no longer fetch for
+                release();
+                setRole(FLEET_CANDIDATE, "stepped down");
+            } else if (reassertClaim || now - lastClaim >= FLEET_RENEW_MS) {
+                claim(now);
+            }
+            break;
+    }
+    reassertClaim = false;
+}
+
+void FleetCoordinator::claim(unsigned long now) {
+    JsonDocument doc(memPolicy.json(MEM_BULK));
+    doc["id"] = deviceId;
+    doc["ts"] = clockService.isValid() ? (uint32_t)clockService.now().epoch : 0;
+    doc["lease_ms"] = FLEET_LEASE_MS;
+
+    String payload;
+    serializeJson(doc, payload);
+    mqtt.publish(FLEET_TOPIC_PREFIX "/leader", payload, true);
+    lastClaim = now;
+    leaderId = deviceId;
+}
+
+void FleetCoordinator::release() {
+    // Retained, so a follower joining later doesn't wait out the old lease
+    JsonDocument doc(memPolicy.json(MEM_BULK));
+    doc["id"] = deviceId;
+    doc["ts"] = clockService.isValid() ? (uint32_t)clockService.now().epoch : 0;
+    doc["released"] = true;
+
+    String payload;
+    serializeJson(doc, payload);
+    mqtt.publish(FLEET_TOPIC_PREFIX "/leader", payload, true);
+    leaderId = "";
+}
+
+void FleetCoordinator::publishWant(Direction dir, unsigned long now) {
+    String topic = String(FLEET_TOPIC_PREFIX "/want/") + deviceId;
+    mqtt.publish(topic.c_str(), directionKey(dir));
+    lastWant = now;
+    lastWantDirection = dir;
+}
+
+bool FleetCoordinator::isLeader() const {
+    return enabled && role == FLEET_LEADER;
+}
+
+bool FleetCoordinator::isFollower() const {
+    return enabled && role == FLEET_FOLLOWER && mqttReady;
+}
+
+bool FleetCoordinator::mayFetch() const {
+    if (!enabled || !mqttReady) return true;  // No broker - fetch locally meanwhile
+    return role == FLEET_LEADER || role == FLEET_SOLO;
+}
+
+FleetRole FleetCoordinator::getRole() const {
+    return role;
+}
+
+const char* FleetCoordinator::getRoleName() const {
+    return ROLE_NAMES[role];
+}
+
+bool FleetCoordinator::isDirectionWanted(Direction dir) const {
+    return wantSeen[dir] != 0 && millis() - wantSeen[dir] < FLEET_DEMAND_TTL_MS;
+}
+
+void FleetCoordinator::publishSnapshot(Direction dir, const BusDeparture* departures, int count) {
+    if (!isLeader()) return;
+
+    JsonDocument doc(memPolicy.json(MEM_BULK));
+    doc["leader"] = deviceId;
+    doc["ts"] = clockService.isValid() ? (uint32_t)clockService.now().epoch : 0;
+    doc["weather"] = weather;
+    JsonArray buses = doc["buses"].to<JsonArray>();
+    for (int i = 0; i < count && i < FLEET_MAX_DEPARTURES; i++) {
+        JsonObject bus = buses.add<JsonObject>();
+        bus["bus"] = departures[i].busNumber;
+        bus["stop"] = departures[i].stopName;
+        bus["dest"] = departures[i].destination;
+        bus["time"] = departures[i].departureTime;
+        bus["mins"] = departures[i].minutesUntilDeparture;
+        bus["walk"] = departures[i].walkingTimeMinutes;
+        bus["live"] = departures[i].isLive;
+        if (departures[i].statusText.length()) {
+            bus["status"] = departures[i].statusText;
+        }
+    }
+
+    String payload;
+    serializeJson(doc, payload);
+    String topic = String(FLEET_TOPIC_PREFIX "/snapshot/") + directionKey(dir);
+    if (mqtt.publish(topic.c_str(), payload, true)) {
+        DEBUG_PRINTF("Fleet: published %s snapshot (%d buses, %u bytes)\n",
+                     directionKey(dir), min(count, FLEET_MAX_DEPARTURES), payload.length());
+    }
+}
+
+void FleetCoordinator::shareWeather(const char* label) {
+    strlcpy(weather, label, sizeof(weather));
+}
+
+bool FleetCoordinator::hasNewSnapshot(Direction dir) const {
+    return snapshots[dir].valid && snapshots[dir].fresh;
+}
+
+int FleetCoordinator::copySnapshot(Direction dir, BusDeparture* out, int maxCount) {
+    Snapshot& snap = snapshots[dir];
+    if (!snap.valid) return -1;
+    snap.fresh = false;
+
+    // Age the countdowns from when the leader fetched
+    unsigned long ageMinutes = (millis() - snap.receivedAt) / 60000;
+    if (snap.epoch != 0 && clockService.isValid()) {
+        uint32_t nowEpoch = clockService.now().epoch;
+        if (nowEpoch > snap.epoch) ageMinutes = (nowEpoch - snap.epoch) / 60;
+    }
+
+    int count = 0;
+    for (int i = 0; i < snap.count && count < maxCount; i++) {
+        out[count] = snap.departures[i];
+        out[count].minutesUntilDeparture -= (int)ageMinutes;
+        if (out[count].minutesUntilDeparture - out[count].walkingTimeMinutes < 0) continue;  // Can't catch it now
+        count++;
+    }
+    return count;
+}
+
+void FleetCoordinator::onMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    static const size_t prefixLen = strlen(FLEET_TOPIC_PREFIX "/");
+    if (!fleet.enabled || strncmp(topic, FLEET_TOPIC_PREFIX "/", prefixLen) != 0) return;
+    const char* sub = topic + prefixLen;
+
+    if (strcmp(sub, "leader") == 0) {
+        fleet.handleLeader(payload, length);
+    } else if (strncmp(sub, "want/", 5) == 0) {
+        fleet.handleWant(payload, length);
+    } else if (strcmp(sub, "snapshot/chelt") == 0) {
+        fleet.handleSnapshot(TO_CHELTENHAM, payload, length);
+    } else if (strcmp(sub, "snapshot/church") == 0) {
+        fleet.handleSnapshot(TO_CHURCHDOWN, payload, length);
+    }
+}
+
+// Runs inside mqtt.loop() - PubSubClient reuses its buffer, so nothing is
+// published from here; replies are left to loop()
+void FleetCoordinator::handleLeader(const uint8_t* payload, unsigned int length) {
+    JsonDocument doc(memPolicy.json(MEM_BULK));
+    if (deserializeJson(doc, (const char*)payload, length)) return;
+    String id = doc["id"] | "";
+    uint32_t ts = doc["ts"] | 0;
+    bool released = doc["released"] | false;
+    if (id.length() == 0) return;
+
+    if (released) {
+        // The leader stepped down - claim after our stagger instead of
+        // waiting for the lease to run out
+        if (id != deviceId && role == FLEET_FOLLOWER && id == leaderId) {
+            leaderId = "";
+            joinedAt = millis() - FLEET_SETTLE_MS;
+            setRole(FLEET_CANDIDATE, "leader stepped down");
+        }
+        return;
+    }
+
+    if (id == deviceId) {
+        // Our own claim, or our retained claim from before a reboot
+        if (role != FLEET_LEADER) reassertClaim = true;
+        return;
+    }
+
+    // A retained claim whose lease ran out long ago doesn't count
+    if (ts != 0 && clockService.isValid() &&
+        clockService.now().epoch > ts + FLEET_LEASE_MS / 1000) {
+        DEBUG_PRINTF("Fleet: ignoring stale claim from %s\n", id.c_str());
+        return;
+    }
+
+    if (role == FLEET_LEADER) {
+        // Two leaders: the lower id keeps it, the other steps down
+        if (id < deviceId) {
+            leaderId = id;
+            lastLeaderSeen = millis();
+            setRole(FLEET_FOLLOWER, "lower id claimed");
+        } else {
+            reassertClaim = true;
+        }
+        return;
+    }
+
+    leaderId = id;
+    lastLeaderSeen = millis();
+    lastWantDirection = -1;  // Tell the (possibly new) leader what we show
+    setRole(FLEET_FOLLOWER, "leader seen");
+}
+
+void FleetCoordinator::handleWant(const uint8_t* payload, unsigned int length) {
+    if (length >= 5 && strncmp((const char*)payload, "chelt", 5) == 0) {
+        wantSeen[TO_CHELTENHAM] = millis();
+    } else if (length >= 6 && strncmp((const char*)payload, "church", 6) == 0) {
+        wantSeen[TO_CHURCHDOWN] = millis();
+    }
+}
+
+void FleetCoordinator::handleSnapshot(int dir, const uint8_t* payload, unsigned int length) {
+    JsonDocument doc(memPolicy.json(MEM_BULK));
+    DeserializationError error = deserializeJson(doc, (const char*)payload, length);
+    if (error) {
+        DEBUG_PRINTF("Fleet: bad snapshot: %s\n", error.c_str());
+        return;
+    }
+
+    Snapshot& snap = snapshots[dir];
+    snap.count = 0;
+    for (JsonObject bus : doc["buses"].as<JsonArray>()) {
+        if (snap.count >= FLEET_MAX_DEPARTURES) break;
+        BusDeparture& dep = snap.departures[snap.count++];
+        dep.busNumber = bus["bus"] | "";
+        dep.stopName = bus["stop"] | "";
+        dep.destination = bus["dest"] | "";
+        dep.departureTime = bus["time"] | "";
+        dep.minutesUntilDeparture = bus["mins"] | 0;
+        dep.walkingTimeMinutes = bus["walk"] | 0;
+        dep.isLive = bus["live"] | false;
+        dep.statusText = bus["status"] | "";
+    }
+    snap.epoch = doc["ts"] | 0;
+    if (doc["weather"].is<const char*>()) {
+        strlcpy(weather, doc["weather"], sizeof(weather));
+    }
+    snap.receivedAt = millis();
+    snap.valid = true;
+    snap.fresh = true;
+    DEBUG_PRINTF("Fleet: %s snapshot from %s, %d buses\n",
+                 dir == TO_CHELTENHAM ? "chelt" : "church",
+                 (doc["leader"] | "?"), snap.count);
+}
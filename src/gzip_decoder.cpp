@@ -0,0 +1,166 @@
+#include "gzip_decoder.h"
+#include "mem_policy.h"
+
+// ============================================================================
+// GZIP RESPONSE DECODER IMPLEMENTATION
+// ============================================================================
+
+GzipDecoder gzipDecoder;
+
+// One block for inflate's state and its 32 KB window. The window size is set
+// by the server's compressor, not by us, so it can't be made smaller - but it
+// is taken once, from PSRAM when there is some, and never fragments the heap.
+static uint8_t* arena = nullptr;
+static size_t arenaUsed = 0;
+
+GzipDecoder::GzipDecoder() {
+    memset(&zs, 0, sizeof(zs));
+    target = nullptr;
+    failed = false;
+    finished = false;
+    started = false;
+    heldLen = 0;
+}
+
+void GzipDecoder::accept(HTTPClient& http) {
+    // collectHeaders() replaces the list, so Date is kept for the clock
+    static const char* headerKeys[] = {"Date", "Content-Encoding"};
+    http.collectHeaders(headerKeys, 2);
+    http.addHeader("Accept-Encoding", "gzip, deflate");
+}
+
+void* GzipDecoder::arenaAlloc(void*, uInt items, uInt size) {
+    size_t bytes = ((size_t)items * size + 7) & ~(size_t)7;
+    if (arenaUsed + bytes > GZIP_ARENA_BYTES) return nullptr;
+    void* ptr = arena + arenaUsed;
+    arenaUsed += bytes;
+    return ptr;
+}
+
+void GzipDecoder::arenaFree(void*, void*) {
+    // Everything is released at once when the next body starts
+}
+
+bool GzipDecoder::readBody(HTTPClient& http, String& out) {
+    String encoding = http.header("Content-Encoding");
+    if (!encoding.equalsIgnoreCase("gzip") && !encoding.equalsIgnoreCase("deflate")) {
+        out = http.getString();
+        return true;
+    }
+
+    if (arena == nullptr) {
+        arena = (uint8_t*)memPolicy.allocate(GZIP_ARENA_BYTES, MEM_BULK);
+        if (arena == nullptr) {
+            DEBUG_PRINTLN("Gzip: no memory for inflate arena");
+            return false;
+        }
+    }
+    arenaUsed = 0;
+
+    // gzip starts straight away; deflate waits for its first two bytes,
+    // which tell a zlib header from a raw stream
+    started = false;
+    heldLen = 0;
+    if (!encoding.equalsIgnoreCase("deflate") && !start(32 + MAX_WBITS)) {  // 32: detect gzip or zlib header
+        return false;
+    }
+
+    out = "";
+    int size = http.getSize();
+    if (size > 0) {
+        out.reserve(size * 4);  // JSON typically inflates four to eight times
+    }
+    target = &out;
+    failed = false;
+    finished = false;
+
+    int written = http.writeToStream(this);
+    if (started) inflateEnd(&zs);
+    target = nullptr;
+
+    if (written < 0 || failed || !finished) {
+        DEBUG_PRINTF("Gzip: body failed (%d, %s)\n", written, zs.msg ? zs.msg : "truncated");
+        return false;
+    }
+
+    DEBUG_PRINTF("Gzip: %lu bytes on air, %lu inflated\n",
+                 (unsigned long)zs.total_in, (unsigned long)zs.total_out);
+    return true;
+}
+
+size_t GzipDecoder::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+bool GzipDecoder::start(int windowBits) {
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = arenaAlloc;
+    zs.zfree = arenaFree;
+    if (inflateInit2(&zs, windowBits) != Z_OK) {
+        DEBUG_PRINTLN("Gzip: inflateInit2 failed");
+        return false;
+    }
+    started = true;
+    return true;
+}
+
+size_t GzipDecoder::write(const uint8_t* data, size_t len) {
+    if (target == nullptr || failed) return 0;
+    if (finished) return len;  // Trailing bytes after the gzip footer
+    if (len == 0) return 0;
+
+    if (!started) {
+        // "deflate" should be zlib-wrapped (RFC 9110), but some servers send
+        // raw deflate, which header detection rejects - look at the header
+        // ourselves (CM = 8 and the FCHECK multiple of 31) and pick the mode
+        if (heldLen + len < 2) {
+            held = data[0];
+            heldLen = 1;
+            return len;
+        }
+        uint8_t cmf = heldLen ? held : data[0];
+        uint8_t flg = heldLen ? data[0] : data[1];
+        bool zlibHeader = (cmf & 0x0F) == 8 && ((cmf << 8) | flg) % 31 == 0;
+        if (!start(zlibHeader ? MAX_WBITS : -MAX_WBITS)) {
+            failed = true;
+            return 0;
+        }
+        if (heldLen) {
+            heldLen = 0;
+            if (!inflateInput(&held, 1)) return 0;
+        }
+    }
+
+    return inflateInput(data, len) ? len : 0;
+}
+
+bool GzipDecoder::inflateInput(const uint8_t* data, size_t len) {
+    if (finished) return true;
+
+    uint8_t chunk[GZIP_CHUNK_BYTES];
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = len;
+
+    // Keep going while input remains or the last step filled the chunk
+    do {
+        zs.next_out = chunk;
+        zs.avail_out = sizeof(chunk);
+        int rc = inflate(&zs, Z_NO_FLUSH);
+
+        size_t produced = sizeof(chunk) - zs.avail_out;
+        if (produced > 0) {
+            target->concat((const char*)chunk, produced);
+        }
+        if (rc == Z_STREAM_END) {
+            finished = true;
+            break;
+        }
+        if (rc == Z_BUF_ERROR) break;  // Needs more input
+        if (rc != Z_OK) {
+            failed = true;
+            return false;  // Makes writeToStream() give up on the body
+        }
+    } while (zs.avail_in > 0 || zs.avail_out == 0);
+
+    return true;
+}
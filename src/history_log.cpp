@@ -0,0 +1,305 @@
+#include "history_log.h"
+#include <LittleFS.h>
+#include <time.h>
+#include "clock_service.h"
+
+// ============================================================================
+// DEPARTURE HISTORY LOG IMPLEMENTATION
+// ============================================================================
+
+HistoryLog historyLog;
+
+// Sealed segments only - the open one is rebuilt by a scan at boot
+static const char* HISTORY_INDEX_PATH = HISTORY_DIR "/index.bin";
+
+HistoryLog::HistoryLog() {
+    mounted = false;
+    segmentCount = 0;
+    pendingCount = 0;
+    dropped = 0;
+}
+
+uint32_t HistoryLog::routeBit(const char* route) {
+    uint32_t hash = 2166136261u;
+    while (*route) {
+        hash ^= (uint8_t)*route++;
+        hash *= 16777619u;
+    }
+    return 1u << (hash & 31);
+}
+
+void HistoryLog::segmentPath(uint32_t seq, char* path, size_t size) {
+    snprintf(path, size, HISTORY_DIR "/%08lu.log", (unsigned long)seq);
+}
+
+void HistoryLog::noteRecord(SegmentInfo& info, const HistoryRecord& record) {
+    if (info.count == 0 || record.aimedAt < info.firstAimed) info.firstAimed = record.aimedAt;
+    if (info.count == 0 || record.aimedAt > info.lastAimed) info.lastAimed = record.aimedAt;
+    info.routeMask |= routeBit(record.route);
+    info.count++;
+}
+
+bool HistoryLog::begin() {
+    if (mounted) return true;
+
+    // Formats the partition on first use, which takes a few seconds
+    if (!LittleFS.begin(true)) {
+        DEBUG_PRINTLN("History: LittleFS mount failed");
+        return false;
+    }
+    LittleFS.mkdir(HISTORY_DIR);
+    mounted = true;
+
+    File index = LittleFS.open(HISTORY_INDEX_PATH, FILE_READ);
+    if (index) {
+        while (segmentCount < HISTORY_MAX_SEGMENTS &&
+               index.read((uint8_t*)&segments[segmentCount], sizeof(SegmentInfo)) == sizeof(SegmentInfo)) {
+            segmentCount++;
+        }
+        index.close();
+    }
+
+    // Drop index entries whose file has gone
+    int kept = 0;
+    for (int i = 0; i < segmentCount; i++) {
+        char path[32];
+        segmentPath(segments[i].seq, path, sizeof(path));
+        if (LittleFS.exists(path)) segments[kept++] = segments[i];
+    }
+    segmentCount = kept;
+
+    // Anything not in the index (the open segment) is scanned
+    File dir = LittleFS.open(HISTORY_DIR);
+    File entry;
+    while (dir && (entry = dir.openNextFile())) {
+        const char* name = entry.name();
+        const char* base = strrchr(name, '/');
+        base = base ? base + 1 : name;
+        entry.close();
+        if (strstr(base, ".log") == nullptr) continue;
+
+        uint32_t seq = strtoul(base, nullptr, 10);
+        bool known = false;
+        for (int i = 0; i < segmentCount; i++) {
+            if (segments[i].seq == seq) known = true;
+        }
+        if (known || segmentCount >= HISTORY_MAX_SEGMENTS) continue;
+
+        SegmentInfo info = {seq, 0, 0, 0, 0};
+        if (scanSegment(info)) segments[segmentCount++] = info;
+    }
+
+    // Oldest first
+    for (int i = 1; i < segmentCount; i++) {
+        SegmentInfo info = segments[i];
+        int j = i - 1;
+        while (j >= 0 && segments[j].seq > info.seq) {
+            segments[j + 1] = segments[j];
+            j--;
+        }
+        segments[j + 1] = info;
+    }
+
+    DEBUG_PRINTF("History: %lu record(s) in %d segment(s), %u/%u KB used\n",
+                 (unsigned long)getRecordCount(), segmentCount,
+                 (unsigned)(LittleFS.usedBytes() / 1024), (unsigned)(LittleFS.totalBytes() / 1024));
+    return true;
+}
+
+bool HistoryLog::scanSegment(SegmentInfo& info) {
+    char path[32];
+    segmentPath(info.seq, path, sizeof(path));
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) return false;
+
+    HistoryRecord batch[16];
+    size_t bytes;
+    while ((bytes = file.read((uint8_t*)batch, sizeof(batch))) >= sizeof(HistoryRecord)) {
+        for (size_t i = 0; i < bytes / sizeof(HistoryRecord); i++) {
+            noteRecord(info, batch[i]);
+        }
+    }
+
+    // A torn tail would misalign every later append - seal the segment
+    if (file.size() % sizeof(HistoryRecord) != 0) {
+        info.count = HISTORY_SEGMENT_RECORDS;
+    }
+    file.close();
+    return true;
+}
+
+bool HistoryLog::saveIndex() {
+    File index = LittleFS.open(HISTORY_INDEX_PATH, FILE_WRITE);
+    if (!index) return false;
+    size_t sealed = segmentCount > 0 ? segmentCount - 1 : 0;
+    size_t bytes = sealed * sizeof(SegmentInfo);
+    bool ok = index.write((const uint8_t*)segments, bytes) == bytes;
+    index.close();
+    return ok;
+}
+
+bool HistoryLog::openSegment() {
+    if (segmentCount > 0 && segments[segmentCount - 1].count < HISTORY_SEGMENT_RECORDS) {
+        return true;
+    }
+
+    // Make room by retiring whole segments, oldest first
+    size_t segmentBytes = (size_t)HISTORY_SEGMENT_RECORDS * sizeof(HistoryRecord);
+    while (segmentCount > 0 &&
+           (segmentCount >= HISTORY_MAX_SEGMENTS ||
+            LittleFS.usedBytes() + segmentBytes > LittleFS.totalBytes())) {
+        char path[32];
+        segmentPath(segments[0].seq, path, sizeof(path));
+        LittleFS.remove(path);
+        memmove(&segments[0], &segments[1], (segmentCount - 1) * sizeof(SegmentInfo));
+        segmentCount--;
+    }
+
+    uint32_t seq = segmentCount > 0 ? segments[segmentCount - 1].seq + 1 : 1;
+    segments[segmentCount++] = {seq, 0, 0, 0, 0};
+    return saveIndex();
+}
+
+void HistoryLog::add(const char* route, const char* stop, uint32_t aimedAt, uint32_t expectedAt) {
+    if (!mounted) return;
+    if (pendingCount >= HISTORY_BATCH_RECORDS) {
+        flush();  // Unusually busy cycle - write early rather than lose records
+    }
+
+    HistoryRecord& record = pending[pendingCount++];
+    memset(&record, 0, sizeof(record));
+    record.observedAt = (uint32_t)clockService.now().epoch;
+    record.aimedAt = aimedAt;
+    record.expectedAt = expectedAt;
+    strlcpy(record.route, route, sizeof(record.route));
+    // A 12-character ATCO code fills the field - no terminator, read back with %.*s
+    memcpy(record.stop, stop, min(strlen(stop), sizeof(record.stop)));
+}
+
+void HistoryLog::flush() {
+    if (!mounted || pendingCount == 0) return;
+
+    int written = 0;
+    while (written < pendingCount && openSegment()) {
+        SegmentInfo& info = segments[segmentCount - 1];
+        int count = min((int)(HISTORY_SEGMENT_RECORDS - info.count), pendingCount - written);
+
+        char path[32];
+        segmentPath(info.seq, path, sizeof(path));
+        File file = LittleFS.open(path, FILE_APPEND);
+        if (!file) break;
+        size_t bytes = file.write((const uint8_t*)&pending[written], count * sizeof(HistoryRecord));
+        file.close();
+
+        int stored = bytes / sizeof(HistoryRecord);
+        for (int i = 0; i < stored; i++) {
+            noteRecord(info, pending[written + i]);
+        }
+        written += stored;
+        if (bytes != count * sizeof(HistoryRecord)) {
+            info.count = HISTORY_SEGMENT_RECORDS;  // Partition full or torn - start a new segment next time
+            break;
+        }
+    }
+
+    if (written < pendingCount) {
+        dropped += pendingCount - written;
+        DEBUG_PRINTF("History: %d record(s) not written (%d dropped so far)\n",
+                     pendingCount - written, dropped);
+    }
+    pendingCount = 0;
+}
+
+uint32_t HistoryLog::getRecordCount() const {
+    uint32_t total = 0;
+    for (int i = 0; i < segmentCount; i++) total += segments[i].count;
+    return total;
+}
+
+bool HistoryLog::parseDay(const String& value, uint32_t& dayStart, uint32_t& dayEnd) const {
+    struct tm day = {};
+    if (value.length() == 0) {
+        const ClockSnapshot& clock = clockService.now();
+        if (!clock.valid) return false;
+        day = clock.local;
+        day.tm_hour = 0;
+        day.tm_min = 0;
+        day.tm_sec = 0;
+    } else {
+        int year, month, mday;
+        if (sscanf(value.c_str(), "%d-%d-%d", &year, &month, &mday) != 3) return false;
+        if (month < 1 || month > 12 || mday < 1 || mday > 31) return false;
+        day.tm_year = year - 1900;
+        day.tm_mon = month - 1;
+        day.tm_mday = mday;
+    }
+    day.tm_isdst = -1;  // Local midnight, GMT or BST
+    dayStart = (uint32_t)mktime(&day);
+    day.tm_mday++;
+    day.tm_isdst = -1;
+    dayEnd = (uint32_t)mktime(&day);
+    return true;
+}
+
+void HistoryLog::streamQuery(WebServer& server) {
+    if (!mounted) {
+        server.send(503, "text/plain", "History log not available\n");
+        return;
+    }
+
+    uint32_t dayStart, dayEnd;
+    if (!parseDay(server.arg("day"), dayStart, dayEnd)) {
+        server.send(400, "text/plain", "day must be YYYY-MM-DD\n");
+        return;
+    }
+    String route = server.arg("route");
+    uint32_t mask = route.length() > 0 ? routeBit(route.c_str()) : 0xFFFFFFFF;
+
+    flush();  // Include this cycle's records
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "route,stop,aimed,expected,observed\n");
+
+    char out[HISTORY_QUERY_CHUNK_BYTES];
+    size_t used = 0;
+    HistoryRecord batch[16];
+
+    for (int s = 0; s < segmentCount; s++) {
+        const SegmentInfo& info = segments[s];
+        // The index rules most segments out without touching the flash
+        if (info.count == 0 || !(info.routeMask & mask)) continue;
+        if (info.lastAimed < dayStart || info.firstAimed >= dayEnd) continue;
+
+        char path[32];
+        segmentPath(info.seq, path, sizeof(path));
+        File file = LittleFS.open(path, FILE_READ);
+        if (!file) continue;
+
+        size_t bytes;
+        while ((bytes = file.read((uint8_t*)batch, sizeof(batch))) >= sizeof(HistoryRecord)) {
+            for (size_t i = 0; i < bytes / sizeof(HistoryRecord); i++) {
+                const HistoryRecord& r = batch[i];
+                if (r.aimedAt < dayStart || r.aimedAt >= dayEnd) continue;
+                if (route.length() > 0 && strncmp(r.route, route.c_str(), sizeof(r.route)) != 0) continue;
+
+                char expected[12] = "";
+                if (r.expectedAt != 0) snprintf(expected, sizeof(expected), "%lu", (unsigned long)r.expectedAt);
+                char line[80];
+                int len = snprintf(line, sizeof(line), "%.*s,%.*s,%lu,%s,%lu\n",
+                                   (int)sizeof(r.route), r.route, (int)sizeof(r.stop), r.stop,
+                                   (unsigned long)r.aimedAt, expected, (unsigned long)r.observedAt);
+                if (len <= 0) continue;
+                if (used + len > sizeof(out)) {
+                    server.sendContent(out, used);
+                    used = 0;
+                }
+                memcpy(out + used, line, len);
+                used += len;
+            }
+        }
+        file.close();
+    }
+
+    if (used > 0) server.sendContent(out, used);
+    server.sendContent("");  // Ends the chunked response
+}
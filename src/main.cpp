@@ -36,6 +36,28 @@
 #endif
 #include "mqtt_ha.h"
 #include "ota_update.h"
+#include "net_log.h"
+#include "black_box.h"
+#include "clock_service.h"
+#include "wifi_fast.h"
+#include "connectivity.h"
+#include "dns_cache.h"
+#include "battery_monitor.h"
+#include "power_policy.h"
+#include "net_window.h"
+#include "weather.h"
+#include "fleet.h"
+#include "cycle_arena.h"
+#include "mem_policy.h"
+#include "render_task.h"
+#include "delay_model.h"
+#include "history_log.h"
+#include "punctuality.h"
+#include "volatility.h"
+#include "presence.h"
+#include "direction_profiles.h"
+#include "service_hours.h"
+#include "esp_heap_caps.h"
 
 // WiFi configuration portal
 Preferences wifiPrefs;
@@ -54,9 +76,8 @@ int apiCallsToday = 0;
 
 // Timing variables
 unsigned long lastBusUpdate = 0;
-unsigned long lastMqttPublish = 0;
+unsigned long busRefreshInterval = 0;  // Current bus job interval
 unsigned long lastBatteryRead = 0;
-unsigned long lastOtaCheck = 0;
 unsigned long lastDisplayRefresh = 0;
 unsigned long lastAutoRefetch = 0;  // Track last automatic refetch to prevent API spam
 unsigned long lastCountdownUpdate = 0;
@@ -100,12 +121,32 @@ void publishMqttState();
 void handleMqttCommand(const String& command);
 void handleDisplayTick(unsigned long now);
 void decrementDepartureCountdowns(unsigned long minutesElapsed);
+void reestimateAgedDepartures();
 String formatFutureTime(int minutesAhead);
 void resetApiCounterIfNewDay();
 void loadApiCounter();
 void saveApiCounter();
 unsigned long calculateOptimalRefreshInterval();
 void incrementApiCallCount(int calls);
+void setupNetworkJobs();
+void runBusJob();
+void runWeatherJob();
+void runOtaJob();
+void runTelemetryJob();
+void runDnsJob();
+void networkLoop();
+void networkTaskMain(void* arg);
+void updateWeatherHeader();
+void showFleetSnapshot();
+void applyDirectionProfile(bool refetch);
+void fetchForFleet(Direction dir);
+
+// Network window job ids
+int busJob = -1;
+int weatherJob = -1;
+int otaJob = -1;
+int telemetryJob = -1;
+int dnsJob = -1;
 
 // ============================================================================
 // SETUP
@@ -126,23 +167,39 @@ void setup() {
     // Button disabled - causes false triggers
     // pinMode(BUTTON_PIN, INPUT);
     
+    // Large mallocs go to PSRAM from here on, leaving internal RAM to WiFi and TLS
+    memPolicy.begin();
+    
+    // Restore the black box before anything can hang again
+    blackBox.init();
+    delayModel.init();
+    punctuality.init();
+    serviceHours.begin();
+    
     // Initialize display first for visual feedback
     DEBUG_PRINTLN("Initializing display...");
     display.init();
     display.clear();  // Full reset to remove ghosting from previous content
     display.showLoading("Starting up...");
     
+    // Scratch memory for fetch cycles, taken once so they can't fragment the heap
+    cycleArena.begin();
+    
+    #if HISTORY_LOG_ENABLED
+    historyLog.begin();
+    #endif
+    
     // Setup WiFi
     DEBUG_PRINTLN("Connecting to WiFi...");
     display.showLoading("Connecting to WiFi...");
     setupWiFi();
     
     if (wifiConnected) {
-        // Setup time synchronization
+        // Start time synchronization (SNTP or the first API response, no waiting)
         DEBUG_PRINTLN("Synchronizing time...");
-        display.showLoading("Syncing time...");
         setupTime();
         updateCurrentTime();
+        dnsCache.init();
         
         // Initialize bus API (Nextbus or Transport)
         #if USE_NEXTBUS_API
@@ -151,24 +208,37 @@ void setup() {
         DEBUG_PRINTLN("Initializing Transport API...");
         #endif
         busApi.init();
+        netLog.init();
+        netLog.log(NETLOG_INFO, "boot v%s, ip %s, rssi %d", FIRMWARE_VERSION,
+                   WiFi.localIP().toString().c_str(), WiFi.RSSI());
         
         // Initialize MQTT
         DEBUG_PRINTLN("Initializing MQTT...");
         display.showLoading("Connecting to MQTT...");
         mqtt.init();
         mqtt.setCommandCallback(handleMqttCommand);
+        fleet.begin(mqtt.getDeviceId());
+        presence.begin();
         mqtt.connect();
         
         // Initialize OTA with display callbacks
         DEBUG_PRINTLN("Initializing OTA...");
         otaManager.init();
+        otaManager.getWebServer().on("/api/blackbox", HTTP_GET, []() {
+            otaManager.getWebServer().send(200, "application/json", blackBox.toJson());
+        });
+        otaManager.getWebServer().on("/api/history", HTTP_GET, []() {
+            historyLog.streamQuery(otaManager.getWebServer());
+        });
         
         // Set up OTA progress callbacks to show on display
         otaManager.setProgressCallback([](int progress) {
+            renderTask.waitIdle();
             display.showOtaProgress("Installing firmware...", progress);
         });
         
         otaManager.setCompleteCallback([](bool success) {
+            renderTask.waitIdle();
             if (success) {
                 display.showOtaProgress("Update complete!", 100);
                 delay(2000);  // Show completion for 2 seconds
@@ -196,30 +266,32 @@ void setup() {
         resetApiCounterIfNewDay();
         
         // Initial battery read
+        batteryMonitor.init();
+        powerPolicy.init();
         readBattery();
         
-        // Wait for time to sync before fetching bus data
-        DEBUG_PRINTLN("Waiting for time sync...");
-        struct tm timeinfo;
-        int syncAttempts = 0;
-        while (!getLocalTime(&timeinfo) && syncAttempts < 20) {
-            delay(500);
-            syncAttempts++;
-            DEBUG_PRINT(".");
-        }
-        DEBUG_PRINTLN();
-        if (getLocalTime(&timeinfo)) {
+        // No waiting for time - the first API response sets the clock before
+        // its departures are parsed if SNTP has not answered by then
+        if (clockService.isValid()) {
             char timeStr[20];
-            strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
-            DEBUG_PRINTF("Time synced: %s\n", timeStr);
+            const ClockSnapshot& clock = clockService.now();
+            strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &clock.local);
+            DEBUG_PRINTF("Time synced from %s: %s\n", clockService.getSourceName(), timeStr);
         } else {
-            DEBUG_PRINTLN("WARNING: Time not synced, but proceeding anyway");
+            DEBUG_PRINTLN("Time not set yet - the first API response will set it");
         }
         
+        // Start in the direction the time of day calls for
+        applyDirectionProfile(false);
+        
         // Fetch initial bus data
         DEBUG_PRINTLN("Fetching initial bus data...");
         display.showLoading("Loading bus times...");
-        if (busApi.isActiveHours()) {
+        if (busApi.isActiveHours() && FLEET_ENABLED && mqtt.isConnected()) {
+            // Another display may already be fetching - the bus job runs once
+            // the election has settled, or the leader's snapshot shows first
+            DEBUG_PRINTLN("Fleet mode - waiting for the election before fetching");
+        } else if (busApi.isActiveHours()) {
             fetchAndDisplayBuses();
         } else {
             // Sleep mode - show nice clock display
@@ -229,10 +301,20 @@ void setup() {
             lastDisplayRefresh = now;
             sleepModeActive = true;
         }
+        
+        // Periodic network work from here on runs in batched windows
+        setupNetworkJobs();
     } else {
         display.showError("WiFi connection failed");
     }
     
+    #if DUAL_CORE_TASKS
+    // From here the network side runs on core 0 and drawing on core 1
+    renderTask.begin();
+    xTaskCreatePinnedToCore(networkTaskMain, "network", NET_TASK_STACK, nullptr,
+                            NET_TASK_PRIORITY, nullptr, NET_TASK_CORE);
+    #endif
+    
     DEBUG_PRINTLN("\nSetup complete!\n");
 }
 
@@ -241,6 +323,21 @@ void setup() {
 // ============================================================================
 
 void loop() {
+    #if DUAL_CORE_TASKS
+    // The network and render tasks have taken over
+    vTaskDelete(NULL);
+    #else
+    networkLoop();
+    #endif
+}
+
+void networkTaskMain(void* arg) {
+    for (;;) {
+        networkLoop();  // Ends in a delay, so the core 0 idle task still runs
+    }
+}
+
+void networkLoop() {
     // Handle WiFi config portal if active
     if (configPortalActive) {
         dnsServer.processNextRequest();
@@ -253,25 +350,34 @@ void loop() {
     
     // Update current time string
     updateCurrentTime();
-    bool activeHours = busApi.isActiveHours();
+    applyDirectionProfile(true);
+    // An empty house counts as outside active hours: clock only, no
+    // fetches, and a fresh fetch as soon as someone is back
+    bool activeHours = busApi.isActiveHours() && presence.isPresent();
     
     if (!activeHours && !sleepModeActive) {
         // Show clock display during sleep hours (no placeholder data)
-        display.showClock(currentTimeStr);
+        renderTask.showClock(currentTimeStr);
         departureCount = 0;  // Clear bus data during sleep
         lastCountdownUpdate = now;
         lastDisplayRefresh = now;
         sleepModeActive = true;
     } else if (activeHours && sleepModeActive) {
         sleepModeActive = false;
-        lastBusUpdate = 0; // Force refresh when coming back online
+        netWindow.trigger(busJob); // Force refresh when coming back online
     }
     
-    // Handle MQTT
-    if (wifiConnected) {
-        mqtt.loop();
-        mqttConnected = mqtt.isConnected();
+    // Link state comes from WiFi events; reconnects and MQTT run in here
+    connectivity.loop();
+    wifiConnected = connectivity.isOnline();
+    mqttConnected = connectivity.isMqttReady();
+    fleet.loop(mqttConnected, busApi.getDirection(), activeHours);
+    static FleetRole lastFleetRole = FLEET_SOLO;
+    if (fleet.getRole() != lastFleetRole) {
+        lastFleetRole = fleet.getRole();
+        if (fleet.isLeader()) netWindow.trigger(busJob);  // Followers are waiting on us
     }
+    dnsCache.loop();  // Collect addresses from background refreshes
     
     // Handle OTA
     otaManager.loop();
@@ -282,49 +388,45 @@ void loop() {
         lastApiCountCheck = now;
     }
     
-    // Calculate optimal refresh interval based on remaining API calls and time
-    unsigned long refreshInterval = calculateOptimalRefreshInterval();
-    
-    // Refresh bus data
-    if (wifiConnected && activeHours && (now - lastBusUpdate >= refreshInterval)) {
-        DEBUG_PRINTLN("Refreshing bus data...");
-        fetchAndDisplayBuses();
-        lastBusUpdate = now;
-    }
-    
     // Read battery
+    batteryMonitor.loop();
     if (now - lastBatteryRead >= BATTERY_READ_INTERVAL_MS) {
         readBattery();
+        powerPolicy.update();
         lastBatteryRead = now;
     }
     
-    // Publish MQTT state every minute
-    if (mqttConnected && (now - lastMqttPublish >= 60000)) {
-        publishMqttState();
-        lastMqttPublish = now;
+    // Calculate optimal refresh interval based on remaining API calls and time,
+    // stretched by the power profile on battery
+    unsigned long refreshInterval = powerPolicy.scaleFetchInterval(calculateOptimalRefreshInterval());
+    
+    // Back off while the data isn't changing, tighten while live times move.
+    // An interval that was already long (budget spent, battery) isn't stretched further.
+    unsigned long plannedInterval = refreshInterval;
+    refreshInterval = (unsigned long)(refreshInterval * volatility.intervalScale(busApi.getDirection()));
+    if (refreshInterval > VOLATILITY_MAX_INTERVAL_MS) {
+        refreshInterval = max(plannedInterval, (unsigned long)VOLATILITY_MAX_INTERVAL_MS);
+    }
+    if (refreshInterval < VOLATILITY_MIN_INTERVAL_MS) {
+        refreshInterval = VOLATILITY_MIN_INTERVAL_MS;
     }
     
-    // Check for OTA updates hourly (silently, only show screen when actually updating)
-    if (wifiConnected && (now - lastOtaCheck >= OTA_CHECK_INTERVAL_MS)) {
-        DEBUG_PRINTLN("Checking for OTA updates (hourly check)...");
-        // Verify WiFi is still connected before attempting check
-        if (WiFi.status() == WL_CONNECTED) {
-            if (otaManager.checkForUpdate()) {
-                String latestVersion = otaManager.getLatestVersion();
-                DEBUG_PRINTF("Update available! Current: %s, Latest: %s\n", FIRMWARE_VERSION, latestVersion.c_str());
-                display.showOtaProgress("Installing v" + latestVersion + "...", 0);
-                delay(1000);  // Show message briefly before starting
-                otaManager.performUpdate(otaManager.getUpdateUrl());
-                // performUpdate will reboot, so we won't reach here
-            } else {
-                DEBUG_PRINTLN("No update available or already up to date");
-                // Continue normally - no OTA screen shown for checks
-            }
-        } else {
-            DEBUG_PRINTLN("WiFi disconnected, skipping OTA check");
-            wifiConnected = false;  // Update connection state
-        }
-        lastOtaCheck = now;
+    // Bus fetch, weather, OTA check and telemetry run together in one
+    // radio-on window, opened when the earliest deadline comes up
+    const PowerSettings& power = powerPolicy.settings();
+    netWindow.setInterval(busJob, refreshInterval);
+    busRefreshInterval = refreshInterval;
+    netWindow.setEnabled(busJob, activeHours && fleet.mayFetch());
+    if (weatherJob >= 0) {
+        netWindow.setEnabled(weatherJob, !fleet.isFollower());  // Comes with the leader's snapshot
+    }
+    netWindow.setInterval(telemetryJob, power.telemetryIntervalMs);
+    netWindow.setInterval(otaJob, power.otaIntervalMs);
+    netWindow.loop(wifiConnected, mqttConnected);
+    
+    // Fleet followers render the leader's snapshot instead of fetching
+    if (fleet.isFollower() && activeHours && fleet.hasNewSnapshot(busApi.getDirection())) {
+        showFleetSnapshot();
     }
     
     // Button disabled - use MQTT command "invert_colors" instead
@@ -332,8 +434,9 @@ void loop() {
     // Update display between API refreshes
     handleDisplayTick(now);
     
-    // Low battery warning
-    if (batteryPercent < 10 && batteryPercent > 0) {
+    // Low battery warning (only once the filter has settled)
+    if (batteryMonitor.isReliable() && batteryPercent < 10 && batteryPercent > 0) {
+        renderTask.waitIdle();
         display.showLowBattery(batteryPercent);
         // Deep sleep to conserve power
         if (ENABLE_DEEP_SLEEP) {
@@ -351,23 +454,9 @@ void loop() {
 // ============================================================================
 
 // Try to connect to WiFi with given credentials
+// Uses the cached BSSID/channel first and only scans if that fails
 bool tryWiFiConnect(const char* ssid, const char* password, int timeoutMs) {
-    WiFi.disconnect(true);
-    delay(100);
-    WiFi.mode(WIFI_STA);
-    WiFi.setSleep(false);
-    
-    DEBUG_PRINTF("Connecting to %s...\n", ssid);
-    WiFi.begin(ssid, password);
-    
-    unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - startTime) < timeoutMs) {
-        delay(500);
-        DEBUG_PRINT(".");
-    }
-    DEBUG_PRINTLN();
-    
-    return WiFi.status() == WL_CONNECTED;
+    return fastWiFi.connect(ssid, password, timeoutMs);
 }
 
 // Start WiFi configuration portal
@@ -419,6 +508,7 @@ void startConfigPortal() {
             wifiPrefs.putString("ssid", ssid);
             wifiPrefs.putString("pass", pass);
             wifiPrefs.end();
+            fastWiFi.forget();
             
             String html = "<!DOCTYPE html><html><head>";
             html += "<meta name='viewport' content='width=device-width,initial-scale=1'>";
@@ -459,6 +549,7 @@ void setupWiFi() {
         DEBUG_PRINTLN("Trying saved WiFi credentials...");
         if (tryWiFiConnect(savedSSID.c_str(), savedPass.c_str(), WIFI_CONNECT_TIMEOUT_MS)) {
             wifiConnected = true;
+            connectivity.begin(savedSSID, savedPass);
             DEBUG_PRINTLN("WiFi connected using saved credentials!");
             DEBUG_PRINTF("IP Address: %s\n", WiFi.localIP().toString().c_str());
             DEBUG_PRINTF("Signal strength: %d dBm\n", WiFi.RSSI());
@@ -471,6 +562,7 @@ void setupWiFi() {
     DEBUG_PRINTLN("Trying default WiFi credentials...");
     if (tryWiFiConnect(WIFI_SSID, WIFI_PASSWORD, WIFI_CONNECT_TIMEOUT_MS)) {
         wifiConnected = true;
+        connectivity.begin(WIFI_SSID, WIFI_PASSWORD);
         DEBUG_PRINTLN("WiFi connected!");
         DEBUG_PRINTF("IP Address: %s\n", WiFi.localIP().toString().c_str());
         DEBUG_PRINTF("Signal strength: %d dBm\n", WiFi.RSSI());
@@ -488,40 +580,23 @@ void setupWiFi() {
 // ============================================================================
 
 void setupTime() {
-    // Configure NTP
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    
-    // Set timezone for UK (GMT/BST)
-    setenv("TZ", "GMT0BST,M3.5.0/1,M10.5.0", 1);
-    tzset();
-    
-    DEBUG_PRINT("Waiting for time sync");
+    // Start SNTP and set the UK timezone - returns immediately. Whichever
+    // answers first, SNTP or the Date header of an API response, sets the clock
+    clockService.init();
     
-    struct tm timeinfo;
-    int attempts = 0;
-    while (!getLocalTime(&timeinfo) && attempts < 10) {
-        DEBUG_PRINT(".");
-        delay(500);
-        attempts++;
-    }
-    
-    DEBUG_PRINTLN();
-    
-    if (getLocalTime(&timeinfo)) {
+    if (clockService.isValid()) {
         char timeStr[20];
-        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
-        DEBUG_PRINTF("Time synchronized: %s\n", timeStr);
+        const ClockSnapshot& clock = clockService.now();
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &clock.local);
+        DEBUG_PRINTF("Time already set: %s\n", timeStr);
     } else {
-        DEBUG_PRINTLN("Failed to sync time");
+        DEBUG_PRINTLN("Time not set yet - waiting on SNTP or the first HTTP response");
     }
 }
 
 void updateCurrentTime() {
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo)) {
-        char buf[6];
-        strftime(buf, sizeof(buf), "%H:%M", &timeinfo);
-        currentTimeStr = String(buf);
+    if (clockService.isValid()) {
+        currentTimeStr = clockService.formatHHMM();
     }
 }
 
@@ -530,31 +605,18 @@ void updateCurrentTime() {
 // ============================================================================
 
 void readBattery() {
-    // Take multiple samples to reduce noise on the ADC line
-    const int samples = 8;
-    int total = 0;
-    for (int i = 0; i < samples; i++) {
-        total += analogRead(BATTERY_PIN);
-        delay(5);
-    }
-    float adcValue = total / (float)samples;
-    
-    // Convert to voltage (account for voltage divider)
-    float voltage = (adcValue / 4095.0f) * BATTERY_ADC_REFERENCE * BATTERY_VOLTAGE_DIVIDER;
-    
-    // Calculate percentage - ensure voltages >= FULL show as 100%
-    float percent;
-    if (voltage >= BATTERY_VOLTAGE_FULL) {
-        percent = 100.0;
+    // Sampling and filtering happen in batteryMonitor.loop() - just take the estimate
+    batteryVoltage = batteryMonitor.getVoltage();
+    batteryPercent = batteryMonitor.getPercent();
+    
+    float hoursLeft = batteryMonitor.getHoursRemaining();
+    if (hoursLeft >= 0) {
+        DEBUG_PRINTF("Battery: %.2fV (%d%%), %.1f%%/h, ~%.0f h left\n", batteryVoltage, batteryPercent,
+                     batteryMonitor.getDischargeRatePerHour(), hoursLeft);
     } else {
-        percent = ((voltage - BATTERY_VOLTAGE_EMPTY) / 
-                   (BATTERY_VOLTAGE_FULL - BATTERY_VOLTAGE_EMPTY)) * 100.0;
+        DEBUG_PRINTF("Battery: %.2fV (%d%%)%s\n", batteryVoltage, batteryPercent,
+                     batteryMonitor.isCharging() ? " charging" : "");
     }
-    
-    batteryVoltage = voltage;
-    batteryPercent = constrain((int)percent, 0, 100);
-    
-    DEBUG_PRINTF("Battery: %.2fV (%d%%)\n", batteryVoltage, batteryPercent);
 }
 
 // ============================================================================
@@ -564,6 +626,13 @@ void readBattery() {
 void fetchAndDisplayBuses(bool forceFetchAll) {
     Direction currentDir = busApi.getDirection();
     
+    // The fleet leader fetches for everyone - show its latest snapshot
+    if (!fleet.mayFetch()) {
+        DEBUG_PRINTLN("Fleet follower - using the leader's snapshot");
+        showFleetSnapshot();
+        return;
+    }
+    
     DEBUG_PRINTLN("============================================");
     DEBUG_PRINTLN("FETCHING BUS DATA");
     #if USE_NEXTBUS_API
@@ -577,6 +646,9 @@ void fetchAndDisplayBuses(bool forceFetchAll) {
     }
     DEBUG_PRINTLN("============================================");
     
+    unsigned long fetchStart = millis();
+    blackBox.beginCycle(apiCallsToday);
+    
     // Increase buffer size to collect more buses (need extra to ensure we always have 3)
     bool success = busApi.fetchDepartures(currentDir, departures, 30, departureCount, forceFetchAll);
     
@@ -597,6 +669,27 @@ void fetchAndDisplayBuses(bool forceFetchAll) {
                  actualApiCalls, (currentDir == TO_CHELTENHAM) ? 3 : 2);
     DEBUG_PRINTF("Result: success=%d, count=%d buses\n\n", success, departureCount);
     
+    unsigned long fetchMs = millis() - fetchStart;
+    netLog.log(fetchMs > NETLOG_SLOW_FETCH_MS ? NETLOG_WARNING : NETLOG_INFO,
+               "fetch dir=%s ok=%d buses=%d calls=%d ms=%lu budget=%d/%d arena=%u largest=%u err=%s",
+               currentDir == TO_CHELTENHAM ? "chelt" : "church", success, departureCount,
+               actualApiCalls, fetchMs, apiCallsToday, API_DAILY_LIMIT,
+               (unsigned)cycleArena.getHighWater(),
+               (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+               busApi.getLastError().c_str());
+    cycleArena.reset();  // Everything parsed has been copied into departures
+    historyLog.flush();  // One append per cycle
+    
+    if (success) {
+        volatility.update(currentDir, departures, departureCount);
+        serviceHours.noteFetch();
+    }
+    
+    if (success) {
+        // Empty too, so followers clear their screens when service ends
+        fleet.publishSnapshot(currentDir, departures, departureCount);  // No-op unless leader
+    }
+    
     if (success && departureCount > 0) {
         showingPlaceholderData = false;
         lastDataFetch = millis();  // Track when we got fresh data
@@ -645,10 +738,12 @@ void fetchAndDisplayBuses(bool forceFetchAll) {
     
     // Update display with full refresh (new data from API)
     // If departureCount is 0, display will show appropriate message
-    display.showBusTimetable(departures, departureCount,
+    // The cycle stays in the render phase until the render task reports back
+    blackBox.endCycle(success, departureCount, actualApiCalls, apiCallsToday);
+    renderTask.showTimetable(departures, departureCount,
                               currentTimeStr, busApi.getDirectionLabel(),
                               batteryPercent, wifiConnected, showingPlaceholderData,
-                              true);  // Force full refresh for new data
+                              true, true);  // Force full refresh for new data
     unsigned long now = millis();
     lastCountdownUpdate = now;
     lastDisplayRefresh = now;
@@ -656,6 +751,8 @@ void fetchAndDisplayBuses(bool forceFetchAll) {
     // Reset auto-refetch timer when we successfully fetch data
     // This ensures normal refreshes also count toward the rate limit
     lastAutoRefetch = now;
+    lastBusUpdate = now;
+    netWindow.markRun(busJob);  // Refetches and commands restart the bus interval too
 }
 
 // Placeholder function removed - we never use placeholder data
@@ -663,9 +760,11 @@ void fetchAndDisplayBuses(bool forceFetchAll) {
 void handleDisplayTick(unsigned long now) {
     // Handle sleep mode - update clock every minute
     if (sleepModeActive) {
-        if (now - lastDisplayRefresh >= 60000) {  // Update every minute
+        // Nobody home during active hours - the clock can lag a little
+        unsigned long clockInterval = busApi.isActiveHours() ? PRESENCE_AWAY_CLOCK_MS : 60000;
+        if (now - lastDisplayRefresh >= clockInterval) {
             updateCurrentTime();  // Ensure time string is current
-            display.showClock(currentTimeStr);
+            renderTask.showClock(currentTimeStr);
             lastDisplayRefresh = now;
         }
         return;
@@ -676,7 +775,7 @@ void handleDisplayTick(unsigned long now) {
         return;
     }
     
-    if (now - lastDisplayRefresh < DISPLAY_PARTIAL_REFRESH_INTERVAL) {
+    if (now - lastDisplayRefresh < powerPolicy.settings().displayTickMs) {
         return;
     }
     
@@ -691,16 +790,53 @@ void handleDisplayTick(unsigned long now) {
             decrementDepartureCountdowns(minutesElapsed);
             lastCountdownUpdate += minutesElapsed * 60000;
         }
+        
+        // Fetches are far apart (budget, battery, quiet timetable) - don't
+        // let the last fetch's times stand unchanged for the whole gap
+        if (busRefreshInterval > 0 && now - lastBusUpdate >= busRefreshInterval) {
+            reestimateAgedDepartures();
+        }
     }
     
     // Use partial refresh for countdown updates (faster, less flashing)
-    display.showBusTimetable(departures, departureCount,
+    renderTask.showTimetable(departures, departureCount,
                               currentTimeStr, busApi.getDirectionLabel(),
                               batteryPercent, wifiConnected, showingPlaceholderData,
                               false);  // Partial refresh
     lastDisplayRefresh = now;
 }
 
+void reestimateAgedDepartures() {
+    // Shift each bus from its aimed time by what the route usually runs at
+    // this hour - a live delay from a fetch this old says little any more
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) return;
+    uint32_t minuteStart = (uint32_t)clock.epoch - clock.local.tm_sec;
+    
+    for (int i = 0; i < departureCount; i++) {
+        BusDeparture& dep = departures[i];
+        if (dep.aimedAt == 0 || dep.stopCode.length() == 0) continue;
+        
+        int aimedIn = ((int32_t)(dep.aimedAt - minuteStart)) / 60;
+        int learned = 0;
+        if (!delayModel.estimate(dep.busNumber.c_str(), dep.stopCode.c_str(),
+                                 clock.minuteOfDay + aimedIn, learned)) {
+            continue;  // Untrained - keep the counted-down time
+        }
+        int minutesUntil = max(0, aimedIn + learned);
+        int estMinute = ((clock.minuteOfDay + minutesUntil) % 1440 + 1440) % 1440;
+        char hhmm[6];
+        snprintf(hhmm, sizeof(hhmm), "%02d:%02d", estMinute / 60, estMinute % 60);
+        char status[20];
+        snprintf(status, sizeof(status), "Est. %+d min", learned);
+        
+        dep.minutesUntilDeparture = minutesUntil;
+        dep.departureTime = hhmm;
+        dep.statusText = status;
+        dep.isLive = false;
+    }
+}
+
 void decrementDepartureCountdowns(unsigned long minutesElapsed) {
     if (minutesElapsed == 0) return;
     
@@ -806,12 +942,12 @@ void saveApiCounter() {
 }
 
 void resetApiCounterIfNewDay() {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
         return;  // Can't check time, skip reset
     }
     
-    unsigned long currentDay = timeinfo.tm_mday;
+    unsigned long currentDay = clock.dayOfMonth;
     
     if (currentDay != lastApiResetDay) {
         DEBUG_PRINTF("New day detected (day %lu). Resetting API counter from %d.\n", currentDay, apiCallsToday);
@@ -832,28 +968,19 @@ unsigned long calculateOptimalRefreshInterval() {
     resetApiCounterIfNewDay();
     
     // Get current time
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
         // Can't get time, use default interval
         return BUS_DATA_REFRESH_INTERVAL_MS;
     }
     
-    // Calculate remaining active hours in the day
-    int currentHour = timeinfo.tm_hour;
-    int remainingActiveHours = 0;
+    // Calculate remaining active minutes in the day (today's service window)
+    int currentHour = clock.local.tm_hour;
+    int windowStart, windowEnd;
+    serviceHours.today(windowStart, windowEnd);
+    int remainingActiveMinutes = windowEnd - max(clock.minuteOfDay, windowStart);
     
-    if (currentHour < ACTIVE_HOURS_START) {
-        // Before active hours - full day remaining
-        remainingActiveHours = ACTIVE_HOURS_END - ACTIVE_HOURS_START;
-    } else if (currentHour >= ACTIVE_HOURS_END) {
-        // After active hours - no more today
-        remainingActiveHours = 0;
-    } else {
-        // During active hours
-        remainingActiveHours = ACTIVE_HOURS_END - currentHour;
-    }
-    
-    if (remainingActiveHours <= 0) {
+    if (remainingActiveMinutes <= 0) {
         // Not in active hours or no time remaining
         return BUS_DATA_REFRESH_INTERVAL_MS;
     }
@@ -867,11 +994,34 @@ unsigned long calculateOptimalRefreshInterval() {
         static int lastWarningHour = -1;
         if (lastWarningHour != currentHour) {
             DEBUG_PRINTLN("WARNING: API limit reached for today! Using 1-hour interval.");
+            netLog.log(NETLOG_WARNING, "budget exhausted: %d/%d calls used", apiCallsToday, API_DAILY_LIMIT);
             lastWarningHour = currentHour;
         }
         return 3600000;  // 1 hour
     }
     
+    #if DIRECTION_PROFILES_ENABLED
+    // Spread the current profile's share of the budget over the time it has left
+    const DirectionProfile* profile = directionSchedule.current();
+    if (profile != nullptr && !directionSchedule.isOverridden()) {
+        int profileCalls = min(remainingCalls, directionSchedule.remainingCalls(apiCallsToday));
+        int profileMinutes = directionSchedule.minutesLeft(clock.minuteOfDay);
+        int stops = directionSchedule.stopsPerRefresh(profile->direction == TO_CHELTENHAM ? 3 : 2);
+        if (profileCalls < stops || profileMinutes <= 0) {
+            DEBUG_PRINTF("Profile '%s' has spent its share (%d calls left) - using 1-hour interval\n",
+                         profile->name, profileCalls);
+            return 3600000;
+        }
+        
+        unsigned long interval = profileMinutes * 60000UL / (profileCalls / stops);
+        interval = (unsigned long)(interval * profile->refreshWeight);
+        interval = constrain(interval, 300000UL, 3600000UL);
+        DEBUG_PRINTF("API rate calc (%s): %d calls left in profile, %d min, %d stops/refresh -> %.1f min\n",
+                     profile->name, profileCalls, profileMinutes, stops, interval / 60000.0f);
+        return interval;
+    }
+    #endif
+    
     // Estimate stops per refresh based on direction
     // With optimization: typically 1-2 stops for Cheltenham (often just 1), 1 for Churchdown
     // We use a conservative estimate to ensure even distribution
@@ -892,12 +1042,12 @@ unsigned long calculateOptimalRefreshInterval() {
     if (maxRefreshes <= 0) {
         // Can't even do one refresh
         DEBUG_PRINTLN("WARNING: Not enough API calls for even one refresh!");
+        netLog.log(NETLOG_WARNING, "budget too low for a refresh: %d calls left", remainingCalls);
         return 3600000;  // 1 hour
     }
     
-    // Calculate interval: spread refreshes evenly over remaining hours
-    // Convert hours to milliseconds
-    unsigned long remainingMs = remainingActiveHours * 3600000UL;
+    // Calculate interval: spread refreshes evenly over remaining time
+    unsigned long remainingMs = remainingActiveMinutes * 60000UL;
     
     // Calculate optimal interval: total time / number of refreshes
     unsigned long optimalInterval = remainingMs / maxRefreshes;
@@ -913,8 +1063,8 @@ unsigned long calculateOptimalRefreshInterval() {
         optimalInterval = 1800000;
     }
     
-    DEBUG_PRINTF("API rate calc: %d calls used, %d remaining, %d hours left, ~%.1f avg stops/refresh -> %lu ms interval (%.1f min)\n",
-                 apiCallsToday, remainingCalls, remainingActiveHours, 
+    DEBUG_PRINTF("API rate calc: %d calls used, %d remaining, %d min left, ~%.1f avg stops/refresh -> %lu ms interval (%.1f min)\n",
+                 apiCallsToday, remainingCalls, remainingActiveMinutes, 
                  (currentDir == TO_CHELTENHAM) ? 1.5f : 1.0f, 
                  optimalInterval, optimalInterval / 60000.0f);
     
@@ -944,6 +1094,169 @@ String formatFutureTime(int minutesAhead) {
     return String(buf);
 }
 
+// ============================================================================
+// NETWORK WINDOW JOBS
+// ============================================================================
+
+void setupNetworkJobs() {
+    const PowerSettings& power = powerPolicy.settings();
+    
+    // The bus fetch anchors the windows (no slack); the rest wait for it
+    busJob = netWindow.addJob("bus", runBusJob, NETJOB_CRITICAL,
+                              calculateOptimalRefreshInterval(), 0);
+    telemetryJob = netWindow.addJob("telemetry", runTelemetryJob, NETJOB_HIGH,
+                                    power.telemetryIntervalMs, NETWIN_TELEMETRY_MAX_DELAY_MS, true);
+    otaJob = netWindow.addJob("ota", runOtaJob, NETJOB_LOW,
+                              power.otaIntervalMs, NETWIN_OTA_MAX_DELAY_MS);
+    // Slack of one interval still starts lookups well inside DNS_REFRESH_AHEAD_S
+    dnsJob = netWindow.addJob("dns", runDnsJob, NETJOB_LOW,
+                              DNS_REFRESH_JOB_MS, DNS_REFRESH_JOB_MS);
+    
+    // Weather is optional - only schedule it when a key is configured
+    if (strlen(WEATHER_API_KEY) >= 10) {
+        weatherClient.init();
+        weatherJob = netWindow.addJob("weather", runWeatherJob, NETJOB_NORMAL,
+                                      WEATHER_UPDATE_INTERVAL_MS, NETWIN_WEATHER_MAX_DELAY_MS);
+    }
+    
+    // The black box from before this boot goes out in the first window
+    if (blackBox.hasPendingReport()) {
+        netWindow.trigger(telemetryJob);
+    }
+}
+
+void runBusJob() {
+    DEBUG_PRINTLN("Refreshing bus data...");
+    fetchAndDisplayBuses();
+    
+    // Fleet leader also covers the other direction if a follower shows it
+    if (fleet.isLeader()) {
+        Direction other = busApi.getDirection() == TO_CHELTENHAM ? TO_CHURCHDOWN : TO_CHELTENHAM;
+        if (fleet.isDirectionWanted(other)) {
+            fetchForFleet(other);
+        }
+    }
+}
+
+void fetchForFleet(Direction dir) {
+    static BusDeparture fleetDepartures[20];
+    int count = 0;
+    
+    // The parser filters destinations by the client's current direction, and
+    // the stop mask belongs to our own profile - swap both for this fetch
+    Direction ownDir = busApi.getDirection();
+    uint8_t ownMask = busApi.getStopMask();
+    busApi.setDirection(dir);
+    #if DIRECTION_PROFILES_ENABLED
+    busApi.setStopMask(directionSchedule.stopMaskFor(dir));
+    #else
+    busApi.setStopMask(0xFF);
+    #endif
+    bool success = busApi.fetchDepartures(dir, fleetDepartures, 20, count, false);
+    busApi.setDirection(ownDir);
+    busApi.setStopMask(ownMask);
+    cycleArena.reset();
+    
+    int calls = busApi.getLastApiCallCount();
+    incrementApiCallCount(calls);
+    netLog.log(NETLOG_INFO, "fleet fetch dir=%s ok=%d buses=%d calls=%d",
+               dir == TO_CHELTENHAM ? "chelt" : "church", success, count, calls);
+    if (success) {
+        fleet.publishSnapshot(dir, fleetDepartures, count);
+    }
+}
+
+void applyDirectionProfile(bool refetch) {
+    #if DIRECTION_PROFILES_ENABLED
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid || !directionSchedule.update(clock.minuteOfDay)) return;
+    
+    const DirectionProfile* profile = directionSchedule.current();
+    bool turned = busApi.getDirection() != profile->direction;
+    busApi.setDirection(profile->direction);
+    busApi.setStopMask(profile->stopMask);
+    DEBUG_PRINTF("Direction profile: %s\n", profile->name);
+    netLog.log(NETLOG_INFO, "profile %s", profile->name);
+    
+    // New direction - the timetable on screen is for the wrong one
+    if (turned && refetch && busJob >= 0) {
+        departureCount = 0;
+        netWindow.trigger(busJob);
+    }
+    #endif
+}
+
+void showFleetSnapshot() {
+    int count = fleet.copySnapshot(busApi.getDirection(), departures, 20);
+    if (count < 0) return;  // Nothing from the leader yet
+    
+    departureCount = count;
+    showingPlaceholderData = false;
+    lastDataFetch = millis();
+    renderTask.setWeather(fleet.getWeather());  // Followers don't fetch weather themselves
+    renderTask.showTimetable(departures, departureCount,
+                              currentTimeStr, busApi.getDirectionLabel(),
+                              batteryPercent, wifiConnected, showingPlaceholderData,
+                              true);
+    unsigned long now = millis();
+    lastCountdownUpdate = now;
+    lastDisplayRefresh = now;
+}
+
+void runWeatherJob() {
+    if (!weatherClient.fetchWeather()) {
+        netLog.log(NETLOG_WARNING, "weather fetch failed: %s", weatherClient.getLastError());
+    }
+    // A failed fetch keeps the cached reading until its TTL runs out
+    updateWeatherHeader();
+}
+
+void updateWeatherHeader() {
+    char label[24];
+    weatherClient.formatLabel(label, sizeof(label));
+    renderTask.setWeather(label);  // No-op unless the label changed
+    fleet.shareWeather(label);     // Followers get it with the next snapshot
+}
+
+void runOtaJob() {
+    // Silent check, the OTA screen only shows when actually updating
+    DEBUG_PRINTLN("Checking for OTA updates...");
+    if (otaManager.checkForUpdate()) {
+        String latestVersion = otaManager.getLatestVersion();
+        DEBUG_PRINTF("Update available! Current: %s, Latest: %s\n", FIRMWARE_VERSION, latestVersion.c_str());
+        renderTask.waitIdle();
+        display.showOtaProgress("Installing v" + latestVersion + "...", 0);
+        delay(1000);  // Show message briefly before starting
+        otaManager.performUpdate(otaManager.getUpdateUrl());
+        // performUpdate will reboot, so we won't reach here
+    } else {
+        DEBUG_PRINTLN("No update available or already up to date");
+    }
+}
+
+void runTelemetryJob() {
+    // Publish the black box from before this boot
+    if (blackBox.hasPendingReport()) {
+        if (mqtt.publish(MQTT_BLACKBOX_TOPIC, blackBox.toJson())) {
+            DEBUG_PRINTF("Published black box report (reset reason: %s)\n", blackBox.getResetReasonName());
+            blackBox.markReported();
+        }
+    }
+    publishMqttState();
+    punctuality.publish();
+    
+    char usage[128];
+    memPolicy.formatUsage(usage, sizeof(usage));
+    netLog.log(NETLOG_INFO, "mem %s", usage);
+    netLog.log(NETLOG_INFO, "delay model slots=%d observed=%d estimated=%d",
+               delayModel.getTrainedSlots(), delayModel.getObservations(), delayModel.getEstimates());
+}
+
+void runDnsJob() {
+    // Background lookups for addresses near expiry, while the radio is on anyway
+    dnsCache.refresh();
+}
+
 // ============================================================================
 // MQTT STATE PUBLISHING
 // ============================================================================
@@ -957,7 +1270,9 @@ void publishMqttState() {
         departureCount,
         WiFi.localIP().toString(),
         FIRMWARE_VERSION,
-        apiCallsToday
+        apiCallsToday,
+        batteryMonitor.getHoursRemaining(),
+        powerPolicy.settings().name
     );
 }
 
@@ -972,12 +1287,15 @@ void handleMqttCommand(const String& command) {
         DEBUG_PRINTLN("Manual refresh requested");
         fetchAndDisplayBuses();
         publishMqttState();
+        netWindow.markRun(telemetryJob);
     }
     else if (command == "toggle_direction") {
         DEBUG_PRINTLN("Direction toggle requested");
         Direction current = busApi.getDirection();
         Direction newDir = (current == TO_CHELTENHAM) ? TO_CHURCHDOWN : TO_CHELTENHAM;
         busApi.setDirection(newDir);
+        busApi.setStopMask(0xFF);
+        directionSchedule.overrideDirection();  // Until the next profile starts
         fetchAndDisplayBuses();
         publishMqttState();
     }
@@ -994,6 +1312,7 @@ void handleMqttCommand(const String& command) {
             if (otaManager.checkForUpdate()) {
                 DEBUG_PRINTLN("Update available, performing update...");
                 String latestVersion = otaManager.getLatestVersion();
+                renderTask.waitIdle();
                 display.showOtaProgress("Installing v" + latestVersion + "...", 0);
                 delay(1000);
                 otaManager.performUpdate(otaManager.getUpdateUrl());
@@ -1008,8 +1327,8 @@ void handleMqttCommand(const String& command) {
         // Force to light mode (for testing)
         DEBUG_PRINTLN("Setting LIGHT mode");
         invertedColors = true;
-        display.setInvertedColors(true);
-        display.showBusTimetable(departures, departureCount,
+        renderTask.setInvertedColors(true);
+        renderTask.showTimetable(departures, departureCount,
                                   currentTimeStr, busApi.getDirectionLabel(),
                                   batteryPercent, wifiConnected, showingPlaceholderData,
                                   true);
@@ -1022,8 +1341,8 @@ void handleMqttCommand(const String& command) {
         // Force to dark mode
         DEBUG_PRINTLN("Setting DARK mode");
         invertedColors = false;
-        display.setInvertedColors(false);
-        display.showBusTimetable(departures, departureCount,
+        renderTask.setInvertedColors(false);
+        renderTask.showTimetable(departures, departureCount,
                                   currentTimeStr, busApi.getDirectionLabel(),
                                   batteryPercent, wifiConnected, showingPlaceholderData,
                                   true);
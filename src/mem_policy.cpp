@@ -0,0 +1,123 @@
+#include "mem_policy.h"
+#include "esp_heap_caps.h"
+
+// ============================================================================
+// MEMORY PLACEMENT POLICY IMPLEMENTATION
+// ============================================================================
+
+MemoryPolicy memPolicy;
+
+// ArduinoJson allocator bound to one placement
+class PlacedJsonAllocator : public ArduinoJson::Allocator {
+public:
+    explicit PlacedJsonAllocator(MemPlacement where) : where(where) {}
+
+    void* allocate(size_t size) override {
+        return memPolicy.allocate(size, where);
+    }
+
+    void deallocate(void* ptr) override {
+        memPolicy.release(ptr);
+    }
+
+    void* reallocate(void* ptr, size_t newSize) override {
+        return memPolicy.reallocate(ptr, newSize, where);
+    }
+
+private:
+    MemPlacement where;
+};
+
+static PlacedJsonAllocator jsonAllocators[MEM_PLACEMENT_COUNT] = {
+    PlacedJsonAllocator(MEM_BULK),
+    PlacedJsonAllocator(MEM_HOT),
+    PlacedJsonAllocator(MEM_DMA)
+};
+
+MemoryPolicy::MemoryPolicy() {
+    psramAvailable = false;
+    for (PlacementStats& s : stats) {
+        s.allocations = 0;
+        s.fallbacks = 0;
+        s.failures = 0;
+    }
+}
+
+void MemoryPolicy::begin() {
+    psramAvailable = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+    if (psramAvailable) {
+        heap_caps_malloc_extmem_enable(MEM_EXTMEM_THRESHOLD);
+    }
+    DEBUG_PRINTF("Memory: internal %u free, PSRAM %u free, malloc >= %d bytes to PSRAM\n",
+                 (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                 (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+                 psramAvailable ? MEM_EXTMEM_THRESHOLD : 0);
+}
+
+uint32_t MemoryPolicy::capsFor(MemPlacement where) {
+    switch (where) {
+        case MEM_BULK: return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+        case MEM_DMA:  return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        default:       return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    }
+}
+
+void* MemoryPolicy::allocate(size_t size, MemPlacement where) {
+    PlacementStats& s = stats[where];
+    void* ptr = nullptr;
+
+    if (where != MEM_BULK || psramAvailable) {
+        ptr = heap_caps_malloc(size, capsFor(where));
+    }
+    if (ptr == nullptr && where == MEM_BULK) {
+        // PSRAM full or absent - internal beats failing
+        ptr = heap_caps_malloc(size, capsFor(MEM_HOT));
+        if (ptr) s.fallbacks++;
+    }
+
+    if (ptr) {
+        s.allocations++;
+    } else {
+        s.failures++;
+        DEBUG_PRINTF("Memory: %u byte allocation failed (placement %d)\n", (unsigned)size, where);
+    }
+    return ptr;
+}
+
+void* MemoryPolicy::reallocate(void* ptr, size_t size, MemPlacement where) {
+    if (ptr == nullptr) return allocate(size, where);
+
+    void* moved = nullptr;
+    if (where != MEM_BULK || psramAvailable) {
+        moved = heap_caps_realloc(ptr, size, capsFor(where));
+    }
+    if (moved == nullptr && where == MEM_BULK) {
+        moved = heap_caps_realloc(ptr, size, capsFor(MEM_HOT));
+        if (moved) stats[where].fallbacks++;
+    }
+    if (moved == nullptr) stats[where].failures++;
+    return moved;
+}
+
+void MemoryPolicy::release(void* ptr) {
+    heap_caps_free(ptr);
+}
+
+ArduinoJson::Allocator* MemoryPolicy::json(MemPlacement where) {
+    return &jsonAllocators[where];
+}
+
+void MemoryPolicy::formatUsage(char* out, size_t outSize) const {
+    snprintf(out, outSize,
+             "int=%u/%u/%u psram=%u/%u bulk=%lu fb=%lu hot=%lu dma=%lu fail=%lu",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM),
+             (unsigned long)stats[MEM_BULK].allocations,
+             (unsigned long)stats[MEM_BULK].fallbacks,
+             (unsigned long)stats[MEM_HOT].allocations,
+             (unsigned long)stats[MEM_DMA].allocations,
+             (unsigned long)(stats[MEM_BULK].failures + stats[MEM_HOT].failures + stats[MEM_DMA].failures));
+}
@@ -1,5 +1,7 @@
 #include "mqtt_ha.h"
 #include <WiFi.h>
+#include "dns_cache.h"
+#include "mem_policy.h"
 
 // ============================================================================
 // MQTT HOME ASSISTANT IMPLEMENTATION
@@ -12,7 +14,11 @@ MQTTHomeAssistant* MQTTHomeAssistant::instance = nullptr;
 MQTTHomeAssistant::MQTTHomeAssistant() : mqttClient(wifiClient) {
     discoveryPublished = false;
     lastReconnectAttempt = 0;
+    reconnectInterval = 0;  // First attempt is immediate
+    tcpState.store(TCP_IDLE);
+    brokerByIp = false;
     commandCallback = nullptr;
+    extraTopicCount = 0;
     instance = this;
     lastPublishedVersion = "";
 }
@@ -20,28 +26,50 @@ MQTTHomeAssistant::MQTTHomeAssistant() : mqttClient(wifiClient) {
 void MQTTHomeAssistant::init() {
     mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
     mqttClient.setCallback(mqttCallback);
-    mqttClient.setBufferSize(1024); // Larger buffer for discovery messages
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE); // Larger buffer for discovery messages (and fleet snapshots)
+    mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
     
     DEBUG_PRINTLN("MQTT client initialized");
     DEBUG_PRINTF("Server: %s:%d\n", MQTT_SERVER, MQTT_PORT);
 }
 
-bool MQTTHomeAssistant::connect() {
-    if (mqttClient.connected()) {
-        return true;
-    }
-    
+bool MQTTHomeAssistant::beginAttempt(bool mayBlock) {
     unsigned long now = millis();
-    if (now - lastReconnectAttempt < 5000) {
-        return false; // Don't retry too frequently
+    if (now - lastReconnectAttempt < reconnectInterval) {
+        return false; // Backing off
     }
     lastReconnectAttempt = now;
     
     DEBUG_PRINTLN("Connecting to MQTT...");
     
+    // Connect by cached address - PubSubClient would resolve the name every time.
+    // From the loop only an address already in the cache is used; a miss is
+    // left to the connect task, so the resolver never holds up the loop.
+    brokerByIp = mayBlock ? dnsCache.resolve(MQTT_SERVER, brokerIp)
+                          : dnsCache.lookup(MQTT_SERVER, brokerIp);
+    if (brokerByIp) {
+        mqttClient.setServer(brokerIp, MQTT_PORT);
+    } else {
+        mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+    }
+    return true;
+}
+
+bool MQTTHomeAssistant::connect() {
+    if (clientConnected()) {
+        return true;
+    }
+    if (!beginAttempt(true)) {
+        return false;
+    }
+    return finishConnect();
+}
+
+bool MQTTHomeAssistant::finishConnect() {
     String clientId = String(MQTT_CLIENT_ID) + "_" + getDeviceId();
     
-    // Set last will for availability
+    // Set last will for availability. With the socket already open (see
+    // reconnectAsync) this is only the CONNECT/CONNACK exchange.
     bool connected = mqttClient.connect(
         clientId.c_str(),
         MQTT_USER,
@@ -54,12 +82,16 @@ bool MQTTHomeAssistant::connect() {
     
     if (connected) {
         DEBUG_PRINTLN("MQTT connected!");
+        reconnectInterval = MQTT_RECONNECT_MIN_MS;
         
         // Publish availability
         publishAvailable();
         
         // Subscribe to command topic
         mqttClient.subscribe(MQTT_COMMAND_TOPIC);
+        for (int i = 0; i < extraTopicCount; i++) {
+            mqttClient.subscribe(extraTopics[i]);
+        }
         
         // Always republish discovery if version changed (to update Home Assistant device registry)
         // or if this is the first time publishing
@@ -74,24 +106,108 @@ bool MQTTHomeAssistant::connect() {
         return true;
     }
     
-    DEBUG_PRINTF("MQTT connection failed, rc=%d\n", mqttClient.state());
+    if (mqttClient.state() == MQTT_CONNECT_FAILED) {
+        dnsCache.invalidate(MQTT_SERVER);  // Broker may have moved
+    }
+    backOff();
     return false;
 }
 
+void MQTTHomeAssistant::backOff() {
+    // Back off so a dead broker isn't dialled every few seconds
+    reconnectInterval = reconnectInterval < MQTT_RECONNECT_MIN_MS
+        ? MQTT_RECONNECT_MIN_MS
+        : min(reconnectInterval * 2, (unsigned long)MQTT_RECONNECT_MAX_MS);
+    DEBUG_PRINTF("MQTT connection failed, rc=%d, retry in %lu s\n", mqttClient.state(), reconnectInterval / 1000);
+}
+
+void MQTTHomeAssistant::tcpConnectTask(void* arg) {
+    MQTTHomeAssistant* self = (MQTTHomeAssistant*)arg;
+    int32_t timeoutMs = MQTT_SOCKET_TIMEOUT_S * 1000;
+    bool ok = self->brokerByIp
+        ? self->wifiClient.connect(self->brokerIp, MQTT_PORT, timeoutMs)
+        : self->wifiClient.connect(MQTT_SERVER, MQTT_PORT, timeoutMs);
+    self->tcpState.store(ok ? TCP_READY : TCP_FAILED);
+    vTaskDelete(NULL);
+}
+
+void MQTTHomeAssistant::reconnectAsync() {
+    switch (tcpState.load()) {
+        case TCP_CONNECTING:
+            return;  // Still dialling - the loop carries on meanwhile
+            
+        case TCP_READY:
+            // Socket is open - PubSubClient reuses it and only sends CONNECT
+            tcpState.store(TCP_IDLE);
+            finishConnect();
+            return;
+            
+        case TCP_FAILED:
+            tcpState.store(TCP_IDLE);
+            if (!brokerByIp) {
+                dnsCache.invalidate(MQTT_SERVER);
+            }
+            backOff();
+            return;
+            
+        default:
+            break;
+    }
+    
+    if (!beginAttempt(false)) {
+        return;
+    }
+    
+    // Dial in a short-lived task: a dead broker or a slow resolver costs
+    // that task up to MQTT_SOCKET_TIMEOUT_S, not the network loop
+    tcpState.store(TCP_CONNECTING);
+    if (xTaskCreatePinnedToCore(tcpConnectTask, "mqtt_tcp", MQTT_CONNECT_TASK_STACK, this, 1,
+                                nullptr, NET_TASK_CORE) != pdPASS) {
+        tcpState.store(TCP_IDLE);
+        backOff();
+    }
+}
+
+void MQTTHomeAssistant::retryNow() {
+    reconnectInterval = 0;
+}
+
 void MQTTHomeAssistant::loop() {
-    if (!mqttClient.connected()) {
-        connect();
+    if (!clientConnected()) {
+        reconnectAsync();
+        return;
     }
     mqttClient.loop();
 }
 
-bool MQTTHomeAssistant::isConnected() {
+bool MQTTHomeAssistant::clientConnected() {
+    // The helper task owns wifiClient while it dials - don't touch the socket
+    if (tcpState.load() != TCP_IDLE) return false;
     return mqttClient.connected();
 }
 
+bool MQTTHomeAssistant::isConnected() {
+    return clientConnected();
+}
+
 void MQTTHomeAssistant::mqttCallback(char* topic, byte* payload, unsigned int length) {
     if (instance == nullptr) return;
     
+    // Everything but commands is handed over without copying
+    if (strcmp(topic, MQTT_COMMAND_TOPIC) != 0) {
+        for (int i = 0; i < instance->extraTopicCount; i++) {
+            const char* filter = instance->extraTopics[i];
+            size_t len = strlen(filter);
+            bool match = (len >= 2 && strcmp(filter + len - 2, "/#") == 0)
+                ? strncmp(topic, filter, len - 1) == 0
+                : strcmp(topic, filter) == 0;
+            if (match) {
+                instance->extraCallbacks[i](topic, payload, length);
+            }
+        }
+        return;
+    }
+    
     String message;
     for (unsigned int i = 0; i < length; i++) {
         message += (char)payload[i];
@@ -108,6 +224,16 @@ void MQTTHomeAssistant::setCommandCallback(void (*callback)(const String& comman
     commandCallback = callback;
 }
 
+void MQTTHomeAssistant::addSubscription(const char* topic, MessageCallback callback) {
+    if (extraTopicCount >= MQTT_MAX_EXTRA_SUBSCRIPTIONS) return;
+    extraTopics[extraTopicCount] = topic;
+    extraCallbacks[extraTopicCount] = callback;
+    extraTopicCount++;
+    if (clientConnected()) {
+        mqttClient.subscribe(topic);
+    }
+}
+
 String MQTTHomeAssistant::getDeviceId() {
     uint8_t mac[6];
     WiFi.macAddress(mac);
@@ -122,7 +248,7 @@ String MQTTHomeAssistant::getMacAddress() {
 }
 
 String MQTTHomeAssistant::getDeviceInfo() {
-    JsonDocument deviceDoc;
+    JsonDocument deviceDoc(memPolicy.json(MEM_BULK));
     
     deviceDoc["identifiers"][0] = "bus_timetable_" + getDeviceId();
     deviceDoc["name"] = DEVICE_FRIENDLY_NAME;
@@ -161,6 +287,26 @@ void MQTTHomeAssistant::publishDiscoveryConfig() {
         "mdi:flash"
     );
     
+    // Estimated battery time remaining (from the discharge trend)
+    publishSensorDiscovery(
+        "Battery Time Left",
+        "battery_hours_left",
+        "duration",
+        "h",
+        "{{ value_json.battery_hours_left | default(none) }}",
+        "mdi:battery-clock"
+    );
+    
+    // Active power profile (mains / battery / saver)
+    publishSensorDiscovery(
+        "Power Mode",
+        "power_mode",
+        nullptr,
+        nullptr,
+        "{{ value_json.power_mode }}",
+        "mdi:power-plug-battery"
+    );
+    
     // WiFi signal strength
     publishSensorDiscovery(
         "WiFi Signal",
@@ -250,13 +396,14 @@ void MQTTHomeAssistant::publishDiscoveryConfig() {
 
 void MQTTHomeAssistant::publishSensorDiscovery(const char* name, const char* uniqueId,
                                                 const char* deviceClass, const char* unit,
-                                                const char* valueTemplate, const char* icon) {
-    JsonDocument doc;
+                                                const char* valueTemplate, const char* icon,
+                                                const char* stateTopic) {
+    JsonDocument doc(memPolicy.json(MEM_BULK));
     String deviceId = getDeviceId();
     
     doc["name"] = name;
     doc["unique_id"] = String("bus_timetable_") + deviceId + "_" + uniqueId;
-    doc["state_topic"] = MQTT_STATE_TOPIC;
+    doc["state_topic"] = stateTopic;
     doc["availability_topic"] = MQTT_AVAILABILITY_TOPIC;
     doc["value_template"] = valueTemplate;
     
@@ -288,7 +435,7 @@ void MQTTHomeAssistant::publishSensorDiscovery(const char* name, const char* uni
 
 void MQTTHomeAssistant::publishButtonDiscovery(const char* name, const char* uniqueId,
                                                 const char* command, const char* icon) {
-    JsonDocument doc;
+    JsonDocument doc(memPolicy.json(MEM_BULK));
     String deviceId = getDeviceId();
     
     doc["name"] = name;
@@ -320,10 +467,12 @@ void MQTTHomeAssistant::publishButtonDiscovery(const char* name, const char* uni
 void MQTTHomeAssistant::publishState(int batteryPercent, float batteryVoltage,
                                       int rssi, const String& direction,
                                       int busCount, const String& ipAddress,
-                                      const String& version, int apiCallsToday) {
-    if (!mqttClient.connected()) return;
+                                      const String& version, int apiCallsToday,
+                                      float batteryHoursLeft,
+                                      const char* powerMode) {
+    if (!clientConnected()) return;
     
-    JsonDocument doc;
+    JsonDocument doc(memPolicy.json(MEM_BULK));
     
     doc["battery_percent"] = batteryPercent;
     doc["battery_voltage"] = batteryVoltage;
@@ -333,6 +482,12 @@ void MQTTHomeAssistant::publishState(int batteryPercent, float batteryVoltage,
     doc["ip_address"] = ipAddress;
     doc["version"] = version;
     doc["api_calls_today"] = apiCallsToday;
+    if (batteryHoursLeft >= 0) {
+        doc["battery_hours_left"] = roundf(batteryHoursLeft * 10) / 10;
+    }
+    if (powerMode) {
+        doc["power_mode"] = powerMode;
+    }
     
     String payload;
     serializeJson(doc, payload);
@@ -341,6 +496,18 @@ void MQTTHomeAssistant::publishState(int batteryPercent, float batteryVoltage,
     DEBUG_PRINTLN("Published state to MQTT");
 }
 
+bool MQTTHomeAssistant::publish(const char* topic, const String& payload, bool retained) {
+    if (!clientConnected()) return false;
+    
+    // Large payloads bypass the fixed client buffer by streaming
+    if (payload.length() + strlen(topic) + 8 > mqttClient.getBufferSize()) {
+        if (!mqttClient.beginPublish(topic, payload.length(), retained)) return false;
+        mqttClient.write((const uint8_t*)payload.c_str(), payload.length());
+        return mqttClient.endPublish() == 1;
+    }
+    return mqttClient.publish(topic, payload.c_str(), retained);
+}
+
 void MQTTHomeAssistant::publishAvailable() {
     mqttClient.publish(MQTT_AVAILABILITY_TOPIC, "online", true);
 }
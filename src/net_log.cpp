@@ -0,0 +1,170 @@
+#include "net_log.h"
+#include <WiFi.h>
+#include <stdarg.h>
+#include <time.h>
+
+// ============================================================================
+// NETWORK LOG SINK IMPLEMENTATION
+// RFC 5424 syslog lines, several per UDP datagram (see netlog_receiver.py)
+// ============================================================================
+
+NetLogger netLog;
+
+static const int NETLOG_FACILITY_LOCAL0 = 16;
+static const size_t NETLOG_DATAGRAM_SIZE = 1200;  // Stay well under a 1500 byte MTU
+
+NetLogger::NetLogger() {
+    head = 0;
+    count = 0;
+    nextSeq = 0;
+    dropped = 0;
+    droppedReported = 0;
+    rateWindowStart = 0;
+    sentInWindow = 0;
+}
+
+void NetLogger::init() {
+    if (!NETLOG_ENABLED) return;
+    DEBUG_PRINTF("Network log sink: %s:%d (%d record buffer)\n",
+                 NETLOG_HOST, NETLOG_PORT, NETLOG_BUFFER_RECORDS);
+}
+
+void NetLogger::log(NetLogLevel level, const char* format, ...) {
+    if (!NETLOG_ENABLED) return;
+
+    // Ring buffer - overwrite the oldest record when full
+    int slot;
+    if (count < NETLOG_BUFFER_RECORDS) {
+        slot = (head + count) % NETLOG_BUFFER_RECORDS;
+        count++;
+    } else {
+        slot = head;
+        head = (head + 1) % NETLOG_BUFFER_RECORDS;
+        dropped++;
+    }
+
+    Record& rec = records[slot];
+    rec.uptimeMs = millis();
+    time_t now = time(nullptr);
+    rec.epoch = (now > 1600000000) ? (uint32_t)now : 0;
+    rec.seq = nextSeq++;
+    rec.level = level;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(rec.text, sizeof(rec.text), format, args);
+    va_end(args);
+}
+
+int NetLogger::formatRecord(const Record& rec, char* out, size_t outSize) const {
+    char timestamp[24] = "-";
+    if (rec.epoch > 0) {
+        time_t t = rec.epoch;
+        struct tm utc;
+        gmtime_r(&t, &utc);
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    }
+
+    // <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [SD] MSG
+    int len = snprintf(out, outSize, "<%d>1 %s %s bus - - [meta@32473 up=\"%lu.%03lu\" seq=\"%lu\"] %s\n",
+                       NETLOG_FACILITY_LOCAL0 * 8 + rec.level,
+                       timestamp,
+                       DEVICE_NAME,
+                       (unsigned long)(rec.uptimeMs / 1000),
+                       (unsigned long)(rec.uptimeMs % 1000),
+                       (unsigned long)rec.seq,
+                       rec.text);
+    if (len < 0) return 0;
+    return min((int)outSize - 1, len);
+}
+
+int NetLogger::flush() {
+    if (!NETLOG_ENABLED || count == 0) return 0;
+    if (WiFi.status() != WL_CONNECTED) return 0;
+
+    // Rate limit: at most NETLOG_MAX_RECORDS_PER_MIN records leave per minute
+    unsigned long now = millis();
+    if (now - rateWindowStart >= 60000) {
+        rateWindowStart = now;
+        sentInWindow = 0;
+    }
+    int budget = NETLOG_MAX_RECORDS_PER_MIN - sentInWindow;
+    if (budget <= 0) return 0;
+
+    // Report overwritten records once, as a synthetic warning. It goes
+    // straight into the first datagram - queuing it in a full ring would
+    // overwrite another record and count as a drop itself
+    Record notice;
+    bool hasNotice = dropped > droppedReported;
+    unsigned long droppedNow = dropped;
+    if (hasNotice) {
+        notice.uptimeMs = millis();
+        time_t wall = time(nullptr);
+        notice.epoch = (wall > 1600000000) ? (uint32_t)wall : 0;
+        notice.seq = nextSeq;
+        notice.level = NETLOG_WARNING;
+        snprintf(notice.text, sizeof(notice.text), "netlog: %lu records dropped (buffer full)",
+                 droppedNow - droppedReported);
+    }
+
+    static char datagram[NETLOG_DATAGRAM_SIZE];
+    char line[NETLOG_MAX_MESSAGE + 128];
+    int sent = 0;
+
+    while ((count > 0 || hasNotice) && sent < budget) {
+        size_t used = 0;
+        int inDatagram = 0;
+        int taken = 0;  // Records from the ring in this datagram
+
+        if (hasNotice) {
+            used = formatRecord(notice, datagram, sizeof(datagram));
+            inDatagram++;
+        }
+
+        // Pack as many whole lines as fit, leaving them in the ring until sent
+        while (taken < count && sent + inDatagram < budget) {
+            int len = formatRecord(records[(head + taken) % NETLOG_BUFFER_RECORDS], line, sizeof(line));
+            if (used + len > sizeof(datagram)) break;
+            memcpy(datagram + used, line, len);
+            used += len;
+            taken++;
+            inDatagram++;
+        }
+
+        if (inDatagram == 0) break;
+
+        if (!udp.beginPacket(NETLOG_HOST, NETLOG_PORT)) {
+            DEBUG_PRINTLN("Network log: beginPacket failed");
+            break;
+        }
+        udp.write((const uint8_t*)datagram, used);
+        if (!udp.endPacket()) {
+            DEBUG_PRINTLN("Network log: send failed");
+            break;  // Kept for the next window
+        }
+
+        // Delivered - only now do the records leave the ring
+        head = (head + taken) % NETLOG_BUFFER_RECORDS;
+        count -= taken;
+        if (hasNotice) {
+            droppedReported = droppedNow;
+            nextSeq++;
+            hasNotice = false;
+        }
+        sent += inDatagram;
+    }
+
+    sentInWindow += sent;
+    if (sent > 0) {
+        DEBUG_PRINTF("Network log: sent %d records (%d pending)\n", sent, count);
+    }
+    return sent;
+}
+
+int NetLogger::getPendingCount() const {
+    return count;
+}
+
+unsigned long NetLogger::getDroppedCount() const {
+    return dropped;
+}
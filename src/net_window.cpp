@@ -0,0 +1,155 @@
+#include "net_window.h"
+#include "net_log.h"
+#include "power_policy.h"
+#include <WiFi.h>
+
+// ============================================================================
+// NETWORK WINDOW IMPLEMENTATION
+// ============================================================================
+
+NetWindow netWindow;
+
+NetWindow::NetWindow() {
+    jobCount = 0;
+    windowCount = 0;
+    hourStart = 0;
+    windowsThisHour = 0;
+    windowsLastHour = -1;
+}
+
+int NetWindow::addJob(const char* name, void (*run)(), NetJobPriority priority,
+                      unsigned long intervalMs, unsigned long maxDelayMs, bool needsMqtt) {
+    if (jobCount >= NETWIN_MAX_JOBS) {
+        DEBUG_PRINTF("Net window: no slot for job %s\n", name);
+        return -1;
+    }
+    Job& job = jobs[jobCount];
+    job.name = name;
+    job.run = run;
+    job.priority = priority;
+    job.intervalMs = intervalMs;
+    job.maxDelayMs = maxDelayMs;
+    job.lastRun = millis();
+    job.needsMqtt = needsMqtt;
+    job.enabled = true;
+    job.triggered = false;
+    return jobCount++;
+}
+
+void NetWindow::setInterval(int id, unsigned long intervalMs) {
+    if (id < 0 || id >= jobCount) return;
+    jobs[id].intervalMs = intervalMs;
+}
+
+void NetWindow::setEnabled(int id, bool enabled) {
+    if (id < 0 || id >= jobCount) return;
+    jobs[id].enabled = enabled;
+}
+
+void NetWindow::trigger(int id) {
+    if (id < 0 || id >= jobCount) return;
+    jobs[id].triggered = true;
+}
+
+void NetWindow::markRun(int id) {
+    if (id < 0 || id >= jobCount) return;
+    jobs[id].lastRun = millis();
+    jobs[id].triggered = false;
+}
+
+bool NetWindow::isRunnable(const Job& job, bool mqttReady) const {
+    return job.enabled && (mqttReady || !job.needsMqtt);
+}
+
+bool NetWindow::isDue(const Job& job, unsigned long now) const {
+    // Jobs nearly due ride along rather than waking the radio again shortly after
+    unsigned long early = job.intervalMs * NETWIN_EARLY_PERCENT / 100;
+    return job.triggered || now - job.lastRun + early >= job.intervalMs;
+}
+
+bool NetWindow::isPastDeadline(const Job& job, unsigned long now) const {
+    return job.triggered || now - job.lastRun >= job.intervalMs + job.maxDelayMs;
+}
+
+void NetWindow::loop(bool online, bool mqttReady) {
+    unsigned long now = millis();
+
+    if (now - hourStart >= 3600000UL) {
+        if (hourStart != 0) {
+            windowsLastHour = windowsThisHour;
+            netLog.log(NETLOG_INFO, "net windows: %d in the last hour", windowsLastHour);
+        }
+        hourStart = now;
+        windowsThisHour = 0;
+    }
+
+    if (!online) return;
+
+    for (int i = 0; i < jobCount; i++) {
+        if (isRunnable(jobs[i], mqttReady) && isPastDeadline(jobs[i], now)) {
+            runWindow(now, mqttReady);
+            return;
+        }
+    }
+}
+
+void NetWindow::runWindow(unsigned long now, bool mqttReady) {
+    // Collect due jobs, ordered by priority (insertion sort keeps
+    // registration order within a priority)
+    int order[NETWIN_MAX_JOBS];
+    int dueCount = 0;
+    for (int i = 0; i < jobCount; i++) {
+        if (!isRunnable(jobs[i], mqttReady) || !isDue(jobs[i], now)) continue;
+        int pos = dueCount++;
+        while (pos > 0 && jobs[order[pos - 1]].priority > jobs[i].priority) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+
+    windowCount++;
+    windowsThisHour++;
+
+    // Full power while the batch runs, back to the profile's sleep after
+    WiFi.setSleep(false);
+
+    int ran = 0;
+    int deferred = 0;
+    for (int n = 0; n < dueCount; n++) {
+        Job& job = jobs[order[n]];
+        unsigned long elapsed = millis() - now;
+
+        // Over budget: only jobs at their deadline (or critical) still run
+        if (elapsed >= NETWIN_BUDGET_MS && job.priority != NETJOB_CRITICAL &&
+            !isPastDeadline(job, millis())) {
+            deferred++;
+            continue;
+        }
+
+        DEBUG_PRINTF("Net window %lu: %s\n", windowCount, job.name);
+        job.triggered = false;
+        job.run();
+        job.lastRun = millis();
+        ran++;
+    }
+
+    unsigned long windowMs = millis() - now;
+    DEBUG_PRINTF("Net window %lu: %d jobs in %lu ms (%d deferred)\n",
+                 windowCount, ran, windowMs, deferred);
+    netLog.log(NETLOG_DEBUG, "window %lu jobs=%d deferred=%d ms=%lu",
+               windowCount, ran, deferred, windowMs);
+
+    // Radio is up anyway - ship queued log records last
+    netLog.flush();
+
+    WiFi.setSleep(powerPolicy.settings().modemSleep);
+}
+
+unsigned long NetWindow::getWindowCount() const {
+    return windowCount;
+}
+
+int NetWindow::getWindowsLastHour() const {
+    return windowsLastHour;
+}
@@ -1,4 +1,12 @@
 #include "nextbus_api.h"
+#include "black_box.h"
+#include "clock_service.h"
+#include "service_hours.h"
+#include "dns_cache.h"
+#include "cycle_arena.h"
+#include "delay_model.h"
+#include "history_log.h"
+#include "punctuality.h"
 
 // ============================================================================
 // NEXTBUS/TRAVELINE API CLIENT IMPLEMENTATION
@@ -54,6 +62,7 @@ bool NextbusAPIClient::isValidRouteForStop(const String& route, const char* stop
 NextbusAPIClient::NextbusAPIClient() {
     currentDirection = TO_CHELTENHAM;
     lastApiCallCount = 0;
+    stopMask = 0xFF;
     messageIdCounter = 1;
 }
 
@@ -71,6 +80,10 @@ Direction NextbusAPIClient::getDirection() const {
     return currentDirection;
 }
 
+void NextbusAPIClient::setStopMask(uint8_t mask) {
+    stopMask = mask;
+}
+
 String NextbusAPIClient::getDirectionLabel() const {
     return currentDirection == TO_CHELTENHAM ? "Cheltenham Spa" : "Churchdown";
 }
@@ -80,12 +93,8 @@ String NextbusAPIClient::getLastError() const {
 }
 
 bool NextbusAPIClient::isActiveHours() const {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        return true; // Default to active if time unknown
-    }
-    int hour = timeinfo.tm_hour;
-    return (hour >= ACTIVE_HOURS_START && hour < ACTIVE_HOURS_END);
+    // Learned service span for today, within ACTIVE_HOURS_START/END
+    return serviceHours.isActive();
 }
 
 bool NextbusAPIClient::canMakeApiCall() const {
@@ -102,10 +111,11 @@ int NextbusAPIClient::getRemainingCallsToday() const {
 
 
 String NextbusAPIClient::getCurrentTimestamp() {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
         return "1970-01-01T00:00:00Z";
     }
+    const struct tm& timeinfo = clock.local;
     
     char timestamp[25];
     // Format: 2014-07-01T15:09:12Z (ISO 8601 UTC)
@@ -173,6 +183,12 @@ bool NextbusAPIClient::fetchDepartures(Direction direction, BusDeparture* depart
     bool fetchedAllStops = false;
     
     for (int i = 0; i < stopCount; i++) {
+        // Stops the direction profile leaves out
+        if (!forceFetchAll && !(stopMask & (1 << i))) {
+            if (i == stopCount - 1) fetchedAllStops = true;
+            continue;
+        }
+        
         String requestXml = buildSiriRequest(stops[i].atcocode);
         DEBUG_PRINTF("Fetching: %s (stop %d/%d)\n", stops[i].name, i + 1, stopCount);
         
@@ -182,6 +198,7 @@ bool NextbusAPIClient::fetchDepartures(Direction direction, BusDeparture* depart
         const int MAX_RETRIES = 2;
         
         while (retries <= MAX_RETRIES && httpCode != HTTP_CODE_OK) {
+            dnsCache.connect(httpClient, NEXTBUS_API_HOST, NEXTBUS_API_PORT);  // Skips the DNS lookup in begin()
             http.begin(httpClient, NEXTBUS_API_BASE);
             http.setTimeout(15000);
             http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
@@ -189,9 +206,15 @@ bool NextbusAPIClient::fetchDepartures(Direction direction, BusDeparture* depart
             // Add HTTP Basic Authentication
             http.setAuthorization(NEXTBUS_API_USERNAME, NEXTBUS_API_PASSWORD);
             http.addHeader("Content-Type", "application/xml");
+            clockService.watchDateHeader(http);
             
             // POST request with SIRI-SM XML body
+            blackBox.markPhase(PHASE_HTTP);
             httpCode = http.POST(requestXml);
+            blackBox.noteHttpCode(httpCode);
+            if (httpCode > 0) {
+                clockService.syncFromResponse(http);  // Before parsing, which needs the time
+            }
             
             if (httpCode != HTTP_CODE_OK && retries < MAX_RETRIES) {
                 DEBUG_PRINTF("HTTP error for %s: %d, retrying... (%d/%d)\n", stops[i].name, httpCode, retries + 1, MAX_RETRIES);
@@ -206,28 +229,37 @@ bool NextbusAPIClient::fetchDepartures(Direction direction, BusDeparture* depart
         lastApiCallCount++;  // Count this API call (even if failed after retries)
         
         if (httpCode == HTTP_CODE_OK) {
-            String response = http.getString();
-            
-            // DEBUG: Print first 500 chars of response to see structure
-            DEBUG_PRINTF("API Response for %s (first 500 chars):\n", stops[i].name);
-            String preview = response.substring(0, 500);
-            DEBUG_PRINTLN(preview);
-            DEBUG_PRINTLN("---");
-            
-            // Pass MAX_BUSES_PER_STOP to limit buses collected per stop
-            int countBeforeStop = count;
-            if (!parseSiriResponse(response, stops[i], departures, count, maxDepartures, MAX_BUSES_PER_STOP)) {
-                DEBUG_PRINTF("Warning: Failed to parse departures for %s (may be no buses running)\n", stops[i].name);
-            }
-            int busesFromThisStop = count - countBeforeStop;
-            DEBUG_PRINTF("Collected %d buses from %s (total: %d)\n", busesFromThisStop, stops[i].name, count);
+            // The body lives in the cycle arena only until this stop is parsed
+            size_t stopMark = cycleArena.mark();
+            size_t responseLength = 0;
+            char* response = cycleArena.readBody(http, responseLength);
             
-            if (count == 0 && i == 0) {
-                DEBUG_PRINTLN("WARNING: First stop returned no departures. This may indicate:");
-                DEBUG_PRINTLN("  - No buses running on target routes (94-98)");
-                DEBUG_PRINTLN("  - Wrong direction filter");
-                DEBUG_PRINTLN("  - API response format issue");
+            if (response == nullptr) {
+                DEBUG_PRINTF("Failed to read response for %s\n", stops[i].name);
+                lastError = "Response too large";
+            } else {
+                // DEBUG: Print first 500 chars of response to see structure
+                DEBUG_PRINTF("API Response for %s (first 500 chars):\n", stops[i].name);
+                DEBUG_PRINTF("%.*s\n", (int)min(responseLength, (size_t)500), response);
+                DEBUG_PRINTLN("---");
+                
+                // Pass MAX_BUSES_PER_STOP to limit buses collected per stop
+                blackBox.markPhase(PHASE_PARSE);
+                int countBeforeStop = count;
+                if (!parseSiriResponse(response, responseLength, stops[i], departures, count, maxDepartures, MAX_BUSES_PER_STOP)) {
+                    DEBUG_PRINTF("Warning: Failed to parse departures for %s (may be no buses running)\n", stops[i].name);
+                }
+                int busesFromThisStop = count - countBeforeStop;
+                DEBUG_PRINTF("Collected %d buses from %s (total: %d)\n", busesFromThisStop, stops[i].name, count);
+                
+                if (count == 0 && i == 0) {
+                    DEBUG_PRINTLN("WARNING: First stop returned no departures. This may indicate:");
+                    DEBUG_PRINTLN("  - No buses running on target routes (94-98)");
+                    DEBUG_PRINTLN("  - Wrong direction filter");
+                    DEBUG_PRINTLN("  - API response format issue");
+                }
             }
+            cycleArena.rewind(stopMark);
         } else {
             DEBUG_PRINTF("HTTP error for %s after %d retries: %d\n", stops[i].name, retries, httpCode);
             if (httpCode == HTTP_CODE_UNAUTHORIZED) {
@@ -372,54 +404,66 @@ int NextbusAPIClient::getLastApiCallCount() const {
     return lastApiCallCount;
 }
 
-// Helper functions for XML parsing
-static String extractXmlTag(const String& xml, const String& tagName, int startPos = 0) {
-    String openTag = "<" + tagName + ">";
-    String closeTag = "</" + tagName + ">";
-    
-    int start = xml.indexOf(openTag, startPos);
-    if (start == -1) return "";
-    
-    start += openTag.length();
-    int end = xml.indexOf(closeTag, start);
-    if (end == -1) return "";
-    
-    return xml.substring(start, end);
+// Helper functions for XML parsing. They work on [from, to) ranges of the
+// response in the cycle arena, so nothing is copied until a value is kept.
+static const char* findInRange(const char* from, const char* to, const char* needle) {
+    size_t needleLen = strlen(needle);
+    for (const char* p = from; p + needleLen <= to; p++) {
+        if (*p == *needle && memcmp(p, needle, needleLen) == 0) {
+            return p;
+        }
+    }
+    return nullptr;
 }
 
-// Helper function to find next occurrence of a tag
-static int findNextTag(const String& xml, const String& tagName, int startPos) {
-    String openTag = "<" + tagName + ">";
-    return xml.indexOf(openTag, startPos);
+// Copy the trimmed text of <tagName>...</tagName> into out ("" if absent)
+static void extractXmlTag(const char* from, const char* to, const char* tagName,
+                          char* out, size_t outSize) {
+    char openTag[40];
+    char closeTag[40];
+    snprintf(openTag, sizeof(openTag), "<%s>", tagName);
+    snprintf(closeTag, sizeof(closeTag), "</%s>", tagName);
+    out[0] = '\0';
+    
+    const char* start = findInRange(from, to, openTag);
+    if (start == nullptr) return;
+    start += strlen(openTag);
+    const char* end = findInRange(start, to, closeTag);
+    if (end == nullptr) return;
+    
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+    size_t len = min((size_t)(end - start), outSize - 1);
+    memcpy(out, start, len);
+    out[len] = '\0';
 }
 
-bool NextbusAPIClient::parseSiriResponse(const String& xmlResponse, const BusStop& stop,
+bool NextbusAPIClient::parseSiriResponse(const char* xml, size_t length, const BusStop& stop,
                                          BusDeparture* departures, int& currentCount, 
                                          int maxCount, int maxPerStop) {
     // Parse SIRI-SM XML response according to Traveline API documentation v2.7
     // Structure: Siri > ServiceDelivery > StopMonitoringDelivery > MonitoredStopVisit[]
+    const char* xmlEnd = xml + length;
     
     // Check for ServiceDelivery
-    if (xmlResponse.indexOf("<ServiceDelivery>") == -1) {
+    if (findInRange(xml, xmlEnd, "<ServiceDelivery>") == nullptr) {
         DEBUG_PRINTLN("No ServiceDelivery found in response");
         return false;
     }
     
     // Find StopMonitoringDelivery
-    int deliveryStart = xmlResponse.indexOf("<StopMonitoringDelivery");
-    if (deliveryStart == -1) {
+    if (findInRange(xml, xmlEnd, "<StopMonitoringDelivery") == nullptr) {
         DEBUG_PRINTLN("No StopMonitoringDelivery found in response");
         return true; // Not an error, just no buses
     }
     
     // Find all MonitoredStopVisit elements
-    int visitPos = 0;
+    const char* visitPos = xml;
     int visitCount = 0;
     int busesAddedFromThisStop = 0;  // Track how many buses we've added from this specific stop
     const int MAX_VISITS_PER_STOP = 30;  // Safety limit to prevent memory issues
     
-    while ((visitPos = findNextTag(xmlResponse, "MonitoredStopVisit", visitPos)) != -1) {
-        // CRITICAL: Check bounds FIRST, before any String operations to prevent memory issues
+    while ((visitPos = findInRange(visitPos, xmlEnd, "<MonitoredStopVisit>")) != nullptr) {
         // Cap at maxPerStop buses per stop (default 3)
         if (busesAddedFromThisStop >= maxPerStop) {
             DEBUG_PRINTF("Reached maxPerStop limit (%d) for %s, stopping collection from this stop\n", 
@@ -442,97 +486,118 @@ bool NextbusAPIClient::parseSiriResponse(const String& xmlResponse, const BusSto
         }
         
         // Find the end of this MonitoredStopVisit
-        int visitEnd = xmlResponse.indexOf("</MonitoredStopVisit>", visitPos);
-        if (visitEnd == -1) break;
-        
-        // Limit substring size to prevent memory issues (max 2KB per visit)
-        int visitLen = visitEnd - visitPos;
-        if (visitLen > 2048) {
-            DEBUG_PRINTF("Warning: MonitoredStopVisit too large (%d bytes), skipping\n", visitLen);
-            visitPos = visitEnd;
-            continue;
-        }
-        
-        String visitXml = xmlResponse.substring(visitPos, visitEnd);
+        const char* visitEnd = findInRange(visitPos, xmlEnd, "</MonitoredStopVisit>");
+        if (visitEnd == nullptr) break;
         
         // Extract PublishedLineName (route number)
-        String route = extractXmlTag(visitXml, "PublishedLineName");
-        route.trim();
+        char route[16];
+        extractXmlTag(visitPos, visitEnd, "PublishedLineName", route, sizeof(route));
         
         // Check if route matches our target routes
-        if (route.length() == 0 || !isTargetRoute(route)) {
+        if (route[0] == '\0' || !isTargetRoute(route)) {
             visitPos = visitEnd;
             continue;
         }
         
         // Extract DirectionName (destination)
-        String direction = extractXmlTag(visitXml, "DirectionName");
-        direction.trim();
+        char direction[64];
+        extractXmlTag(visitPos, visitEnd, "DirectionName", direction, sizeof(direction));
         
         // Check if direction matches our filter
         if (!isValidDestination(direction, currentDirection)) {
             DEBUG_PRINTF("  SKIPPED: Bus %s - direction '%s' does not match filter\n", 
-                        route.c_str(), direction.c_str());
+                        route, direction);
             visitPos = visitEnd;
             continue;
         }
         
         // Extract MonitoredCall section
-        int callStart = visitXml.indexOf("<MonitoredCall>");
-        if (callStart == -1) {
+        const char* callStart = findInRange(visitPos, visitEnd, "<MonitoredCall>");
+        if (callStart == nullptr) {
             visitPos = visitEnd;
             continue;
         }
-        int callEnd = visitXml.indexOf("</MonitoredCall>", callStart);
-        if (callEnd == -1) {
+        const char* callEnd = findInRange(callStart, visitEnd, "</MonitoredCall>");
+        if (callEnd == nullptr) {
             visitPos = visitEnd;
             continue;
         }
-        String callXml = visitXml.substring(callStart, callEnd);
         
         // Extract AimedDepartureTime (scheduled)
-        String aimedTime = extractXmlTag(callXml, "AimedDepartureTime");
-        aimedTime.trim();
+        char aimedTime[40];
+        extractXmlTag(callStart, callEnd, "AimedDepartureTime", aimedTime, sizeof(aimedTime));
         
         // Extract ExpectedDepartureTime (real-time, optional)
-        String expectedTime = extractXmlTag(callXml, "ExpectedDepartureTime");
-        expectedTime.trim();
+        char expectedTime[40];
+        extractXmlTag(callStart, callEnd, "ExpectedDepartureTime", expectedTime, sizeof(expectedTime));
         
         // Use expected time if available, otherwise use aimed time
-        String timeToUse = expectedTime.length() > 0 ? expectedTime : aimedTime;
+        const char* timeToUse = expectedTime[0] != '\0' ? expectedTime : aimedTime;
         
         // Calculate minutes until departure
         String displayTime;
         int minutesUntil;
         parseDepartureTime(timeToUse, "", displayTime, minutesUntil);
         
-        // Skip if bus already departed
-        if (minutesUntil < 0) {
-            DEBUG_PRINTF("  SKIPPED: Bus %s - already departed (minutesUntil: %d)\n", 
-                        route.c_str(), minutesUntil);
-            visitPos = visitEnd;
-            continue;
+        // Determine if live or scheduled
+        bool isLive = expectedTime[0] != '\0';
+        int aimedMinutes = minutesUntil;
+        if (isLive && aimedTime[0] != '\0') {
+            String unused;
+            parseDepartureTime(aimedTime, "", unused, aimedMinutes);
         }
         
-        // Determine if live or scheduled
-        bool isLive = expectedTime.length() > 0;
+        // Keep the observation for the punctuality history
+        const ClockSnapshot& clock = clockService.now();
+        if (clock.valid && aimedMinutes < 999 && minutesUntil < 999) {
+            uint32_t minuteStart = (uint32_t)clock.epoch - clock.local.tm_sec;
+            historyLog.add(route, stop.atcocode, minuteStart + aimedMinutes * 60,
+                           isLive ? minuteStart + minutesUntil * 60 : 0);
+            serviceHours.observe(minuteStart + aimedMinutes * 60);
+        }
         
         // Calculate delay
-        String statusText = "";
-        if (isLive && aimedTime.length() > 0) {
-            String unused;
-            int aimedMinutes;
-            parseDepartureTime(aimedTime, "", unused, aimedMinutes);
+        char statusText[20];
+        if (isLive && aimedTime[0] != '\0') {
             int delay = minutesUntil - aimedMinutes;
+            // Late buses whose aimed time has passed count too - they carry the biggest delays
+            if (clock.valid && aimedMinutes < 999 && minutesUntil < 999) {
+                delayModel.observe(route, stop.atcocode, clock.minuteOfDay + aimedMinutes, delay);
+            }
+            if (clock.valid && aimedMinutes < 999) {
+                uint32_t minuteStart = (uint32_t)clock.epoch - clock.local.tm_sec;
+                punctuality.observe(route, stop.atcocode, stop.name, minuteStart + aimedMinutes * 60,
+                                    minuteStart + minutesUntil * 60, delay);
+            }
             if (delay >= 2) {
-                statusText = "Delayed " + String(delay) + " min";
+                snprintf(statusText, sizeof(statusText), "Delayed %d min", delay);
             } else if (delay <= -2) {
-                statusText = "Early " + String(-delay) + " min";
+                snprintf(statusText, sizeof(statusText), "Early %d min", -delay);
             } else {
-                statusText = "On time";
+                strlcpy(statusText, "On time", sizeof(statusText));
             }
         } else {
-            statusText = isLive ? "Live" : "Scheduled";
+            strlcpy(statusText, isLive ? "Live" : "Scheduled", sizeof(statusText));
+            
+            // No real-time data - shift by what this route usually runs at
+            int learned = 0;
+            if (!isLive && clock.valid && minutesUntil < 999 &&
+                delayModel.estimate(route, stop.atcocode, clock.minuteOfDay + minutesUntil, learned) && learned != 0) {
+                minutesUntil += learned;
+                int estMinute = ((clock.minuteOfDay + minutesUntil) % 1440 + 1440) % 1440;
+                char hhmm[6];
+                snprintf(hhmm, sizeof(hhmm), "%02d:%02d", estMinute / 60, estMinute % 60);
+                displayTime = hhmm;
+                snprintf(statusText, sizeof(statusText), "Est. %+d min", learned);
+            }
+        }
+        
+        // Skip if bus already departed
+        if (minutesUntil < 0) {
+            DEBUG_PRINTF("  SKIPPED: Bus %s - already departed (minutesUntil: %d)\n", 
+                        route, minutesUntil);
+            visitPos = visitEnd;
+            continue;
         }
         
         // CRITICAL: Final bounds check right before write - this is the last line of defense
@@ -561,9 +626,12 @@ bool NextbusAPIClient::parseSiriResponse(const String& xmlResponse, const BusSto
         departures[idx].walkingTimeMinutes = stop.walkingTimeMinutes;
         departures[idx].isLive = isLive;
         departures[idx].statusText = statusText;
+        departures[idx].stopCode = stop.atcocode;
+        departures[idx].aimedAt = (clock.valid && aimedMinutes < 999)
+                                  ? (uint32_t)clock.epoch - clock.local.tm_sec + aimedMinutes * 60 : 0;
         
         DEBUG_PRINTF("  ADDED: Bus %s from %s at %s (in %d min, walk %d) [count=%d/%d, from_stop=%d/%d]\n",
-                    route.c_str(), stop.name, displayTime.c_str(),
+                    route, stop.name, displayTime.c_str(),
                     minutesUntil, stop.walkingTimeMinutes, idx + 1, maxCount, 
                     busesAddedFromThisStop + 1, maxPerStop);
         
@@ -577,10 +645,10 @@ bool NextbusAPIClient::parseSiriResponse(const String& xmlResponse, const BusSto
     return true;
 }
 
-void NextbusAPIClient::parseDepartureTime(const String& timeStr, const String& estimateStr,
+void NextbusAPIClient::parseDepartureTime(const char* timeStr, const char* estimateStr,
                                          String& displayTime, int& minutesUntil) {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
         // Time not synced - return invalid values that will cause retry
         displayTime = "??:??";
         minutesUntil = -1;  // Negative so it gets filtered out and we retry when time syncs
@@ -588,96 +656,67 @@ void NextbusAPIClient::parseDepartureTime(const String& timeStr, const String& e
     }
     
     // Determine which time string to use for display
-    String actualTimeStr = timeStr;
-    if (actualTimeStr.length() == 0 && estimateStr.length() > 0) {
+    const char* actualTimeStr = timeStr;
+    if (actualTimeStr[0] == '\0' && estimateStr[0] != '\0') {
         actualTimeStr = estimateStr;
     }
     
+    int depHour = 0;
+    int depMin = 0;
+    bool isIso = false;
+    bool parsed = false;
+    
     // Parse ISO 8601 format: 2014-07-01T15:09:00.000+01:00 or 2014-07-01T15:09:00Z
-    if (actualTimeStr.length() >= 16 && actualTimeStr.indexOf('T') > 0) {
-        // Extract time portion (HH:MM) from ISO 8601
-        int tPos = actualTimeStr.indexOf('T');
-        if (tPos > 0) {
-            String timePortion = actualTimeStr.substring(tPos + 1);
-            // Remove timezone offset if present (Z, +01:00, -05:00, etc.)
-            int zPos = timePortion.indexOf('Z');
-            int plusPos = timePortion.indexOf('+');
-            int minusPos = timePortion.indexOf('-', 1);  // Skip the minus in the time itself
-            int offsetPos = -1;
-            if (zPos > 0) {
-                offsetPos = zPos;
-            } else if (plusPos > 0) {
-                offsetPos = plusPos;
-            } else if (minusPos > 0) {
-                offsetPos = minusPos;
-            }
-            if (offsetPos > 0) {
-                timePortion = timePortion.substring(0, offsetPos);
-            }
-            
-            int colonPos = timePortion.indexOf(':');
-            if (colonPos > 0) {
-                int depHour = timePortion.substring(0, colonPos).toInt();
-                int depMin = timePortion.substring(colonPos + 1, colonPos + 3).toInt();
-                
-                // Format display time
-                char timeBuf[6];
-                snprintf(timeBuf, sizeof(timeBuf), "%02d:%02d", depHour, depMin);
-                displayTime = String(timeBuf);
-                
-                // Calculate minutes until departure
-                // Note: API times are in local UK time (GMT/BST), so no conversion needed
-                int nowMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-                int depMinutes = depHour * 60 + depMin;
-                
-                // Handle overnight (if departure is more than 12 hours in the past, assume next day)
-                if (depMinutes < nowMinutes - 720) {
-                    depMinutes += 24 * 60;
-                }
-                
-                minutesUntil = depMinutes - nowMinutes;
-                
-                // Sanity check - if result seems wrong, try next day
-                if (minutesUntil < -60) {
-                    // More than an hour in the past - probably wrong, try next day
-                    depMinutes += 24 * 60;
-                    minutesUntil = depMinutes - nowMinutes;
-                }
-                
-                return;
-            }
-        }
+    // Only the HH:MM straight after the T matters - the offset is ignored
+    const char* tPos = strchr(actualTimeStr, 'T');
+    if (strlen(actualTimeStr) >= 16 && tPos != nullptr && tPos > actualTimeStr) {
+        isIso = true;
+        parsed = sscanf(tPos + 1, "%d:%2d", &depHour, &depMin) == 2;
+    } else if (strlen(actualTimeStr) >= 5 && strchr(actualTimeStr, ':') != nullptr) {
+        // Fallback: try to parse as simple HH:MM format
+        parsed = sscanf(actualTimeStr, "%d:%2d", &depHour, &depMin) == 2;
     }
     
-    // Fallback: try to parse as simple HH:MM format
-    if (actualTimeStr.length() >= 5 && actualTimeStr.indexOf(':') > 0) {
-        int colonPos = actualTimeStr.indexOf(':');
-        int depHour = actualTimeStr.substring(0, colonPos).toInt();
-        int depMin = actualTimeStr.substring(colonPos + 1, colonPos + 3).toInt();
-        
-        char timeBuf[6];
-        snprintf(timeBuf, sizeof(timeBuf), "%02d:%02d", depHour, depMin);
-        displayTime = String(timeBuf);
-        
-        int nowMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-        int depMinutes = depHour * 60 + depMin;
-        
-        if (depMinutes < nowMinutes - 720) {
-            depMinutes += 24 * 60;
-        }
-        
-        minutesUntil = depMinutes - nowMinutes;
+    if (!parsed) {
+        // No valid time string
+        displayTime = "??:??";
+        minutesUntil = 999;  // Don't filter out - might be a parsing issue
         return;
     }
     
-    // No valid time string
-    displayTime = "??:??";
-    minutesUntil = 999;  // Don't filter out - might be a parsing issue
+    // Format display time
+    char timeBuf[6];
+    snprintf(timeBuf, sizeof(timeBuf), "%02d:%02d", depHour, depMin);
+    displayTime = timeBuf;
+    
+    // Calculate minutes until departure
+    // Note: API times are in local UK time (GMT/BST), so no conversion needed
+    int nowMinutes = clock.minuteOfDay;
+    int depMinutes = depHour * 60 + depMin;
+    
+    // Handle overnight (if departure is more than 12 hours in the past, assume next day)
+    if (depMinutes < nowMinutes - 720) {
+        depMinutes += 24 * 60;
+    }
+    
+    minutesUntil = depMinutes - nowMinutes;
+    
+    // Sanity check - if result seems wrong, try next day
+    if (isIso && minutesUntil < -60) {
+        // More than an hour in the past - probably wrong, try next day
+        depMinutes += 24 * 60;
+        minutesUntil = depMinutes - nowMinutes;
+    }
 }
 
-bool NextbusAPIClient::isValidDestination(const String& destination, Direction dir) {
-    String lower = destination;
-    lower.toLowerCase();
+bool NextbusAPIClient::isValidDestination(const char* destination, Direction dir) {
+    char lower[64];
+    size_t len = strlen(destination);
+    if (len >= sizeof(lower)) len = sizeof(lower) - 1;
+    for (size_t i = 0; i < len; i++) {
+        lower[i] = tolower((unsigned char)destination[i]);
+    }
+    lower[len] = '\0';
     
     const char** targets;
     int numTargets;
@@ -691,23 +730,22 @@ bool NextbusAPIClient::isValidDestination(const String& destination, Direction d
     }
     
     for (int i = 0; i < numTargets; i++) {
-        if (lower.indexOf(targets[i]) >= 0) {
-            DEBUG_PRINTF("Direction match: '%s' contains '%s'\n", lower.c_str(), targets[i]);
+        if (strstr(lower, targets[i]) != nullptr) {
+            DEBUG_PRINTF("Direction match: '%s' contains '%s'\n", lower, targets[i]);
             return true;
         }
     }
     
     DEBUG_PRINTF("Direction NO MATCH: '%s' does not match any target for direction %s\n", 
-                lower.c_str(), dir == TO_CHELTENHAM ? "TO_CHELTENHAM" : "TO_CHURCHDOWN");
+                lower, dir == TO_CHELTENHAM ? "TO_CHELTENHAM" : "TO_CHURCHDOWN");
     return false;
 }
 
-bool NextbusAPIClient::isTargetRoute(const String& route) {
+bool NextbusAPIClient::isTargetRoute(const char* route) {
     for (int i = 0; i < routeCount; i++) {
-        if (route == targetRoutes[i]) {
+        if (strcmp(route, targetRoutes[i]) == 0) {
             return true;
         }
     }
     return false;
 }
-
@@ -4,6 +4,10 @@
 #include <WiFi.h>
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
+#include "clock_service.h"
+#include "dns_cache.h"
+#include "gzip_decoder.h"
+#include "mem_policy.h"
 
 // ============================================================================
 // OTA UPDATE MANAGER IMPLEMENTATION
@@ -190,21 +194,30 @@ bool OTAUpdateManager::checkForUpdate() {
     
     HTTPClient http;
     
-    String url = "https://api.github.com/repos/" + 
+    String url = "https://" OTA_GITHUB_API_HOST "/repos/" + 
                  String(OTA_GITHUB_USER) + "/" + 
                  String(OTA_GITHUB_REPO) + "/releases/latest";
     
+    dnsCache.connect(client, OTA_GITHUB_API_HOST, 443);
     http.begin(client, url);
     http.addHeader("Accept", "application/vnd.github.v3+json");
     http.addHeader("User-Agent", "ESP32-OTA");
     http.setTimeout(10000);
+    clockService.watchDateHeader(http);
+    #if OTA_GITHUB_GZIP
+    GzipDecoder::accept(http);
+    #endif
     
     int httpCode = http.GET();
+    if (httpCode > 0) {
+        clockService.syncFromResponse(http);
+    }
     
     if (httpCode == HTTP_CODE_OK) {
-        String response = http.getString();
+        String response;
+        bool ok = gzipDecoder.readBody(http, response);
         http.end();
-        return parseReleaseInfo(response);
+        return ok && parseReleaseInfo(response);
     }
     
     DEBUG_PRINTF("GitHub API error: %d\n", httpCode);
@@ -213,7 +226,7 @@ bool OTAUpdateManager::checkForUpdate() {
 }
 
 bool OTAUpdateManager::parseReleaseInfo(const String& jsonResponse) {
-    JsonDocument doc;
+    JsonDocument doc(memPolicy.json(MEM_BULK));
     DeserializationError error = deserializeJson(doc, jsonResponse);
     
     if (error) {
@@ -461,6 +474,10 @@ bool OTAUpdateManager::isUpdating() const {
     return updating;
 }
 
+WebServer& OTAUpdateManager::getWebServer() {
+    return otaWebServer;
+}
+
 void OTAUpdateManager::setProgressCallback(void (*callback)(int progress)) {
     progressCallback = callback;
 }
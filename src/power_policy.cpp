@@ -0,0 +1,83 @@
+#include "power_policy.h"
+#include "battery_monitor.h"
+#include "render_task.h"
+#include "net_log.h"
+#include <WiFi.h>
+
+// ============================================================================
+// POWER POLICY IMPLEMENTATION
+// ============================================================================
+
+PowerPolicy powerPolicy;
+
+// Base profiles - fetchScale is adjusted with the charge level in update()
+static const PowerSettings PROFILES[] = {
+    // mode           name       scale  tick     clear  sleep  telemetry  OTA
+    { POWER_MAINS,   "mains",   1.0f,  60000,   2,     false, 60000,     OTA_CHECK_INTERVAL_MS },
+    { POWER_BATTERY, "battery", 1.0f,  60000,   1,     true,  300000,    6 * 3600000UL },
+    { POWER_SAVER,   "saver",   2.0f,  300000,  1,     true,  900000,    24 * 3600000UL },
+};
+
+PowerPolicy::PowerPolicy() {
+    current = PROFILES[POWER_MAINS];
+    initialized = false;
+}
+
+void PowerPolicy::init() {
+    apply(chooseMode());
+    initialized = true;
+    update();
+}
+
+PowerMode PowerPolicy::chooseMode() const {
+    if (batteryMonitor.isCharging() || batteryMonitor.getVoltage() >= POWER_MAINS_VOLTAGE) {
+        return POWER_MAINS;
+    }
+
+    // Hysteresis so the profile doesn't flap around the threshold
+    int percent = batteryMonitor.getPercent();
+    if (current.mode == POWER_SAVER && initialized) {
+        return percent >= POWER_SAVER_EXIT_PERCENT ? POWER_BATTERY : POWER_SAVER;
+    }
+    return percent < POWER_SAVER_ENTER_PERCENT ? POWER_SAVER : POWER_BATTERY;
+}
+
+void PowerPolicy::apply(PowerMode mode) {
+    current = PROFILES[mode];
+
+    WiFi.setSleep(current.modemSleep);
+    renderTask.setClearCycles(current.clearCycles);  // The render task may be drawing
+
+    DEBUG_PRINTF("Power profile: %s (battery %d%%, %.2fV)\n", current.name,
+                 batteryMonitor.getPercent(), batteryMonitor.getVoltage());
+    netLog.log(NETLOG_INFO, "power profile %s at %d%%", current.name, batteryMonitor.getPercent());
+}
+
+bool PowerPolicy::update() {
+    // Don't switch on an unsettled filter
+    if (!batteryMonitor.isReliable()) return false;
+
+    PowerMode mode = chooseMode();
+    bool changed = mode != current.mode;
+    if (changed) {
+        apply(mode);
+    }
+
+    // Trade freshness for runtime gradually: 1x at full charge rising to
+    // ~1.7x near the saver threshold, then 2x-5x inside saver
+    int percent = batteryMonitor.getPercent();
+    if (current.mode == POWER_BATTERY) {
+        current.fetchScale = 1.0f + (100 - percent) / 100.0f;
+    } else if (current.mode == POWER_SAVER) {
+        current.fetchScale = 2.0f + max(0, POWER_SAVER_ENTER_PERCENT - percent) / 10.0f;
+    }
+    return changed;
+}
+
+const PowerSettings& PowerPolicy::settings() const {
+    return current;
+}
+
+unsigned long PowerPolicy::scaleFetchInterval(unsigned long baseMs) const {
+    return (unsigned long)(baseMs * current.fetchScale);
+}
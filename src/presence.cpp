@@ -0,0 +1,80 @@
+#include "presence.h"
+#include "mqtt_ha.h"
+#include "net_log.h"
+
+// ============================================================================
+// PRESENCE GATE IMPLEMENTATION
+// ============================================================================
+
+PresenceGate presence;
+
+PresenceGate::PresenceGate() {
+    enabled = false;
+    occupancyKnown = false;
+    occupied = true;
+    leftAt = 0;
+    motionAt = 0;
+    wasPresent = true;
+}
+
+void PresenceGate::begin() {
+    if (strlen(PRESENCE_TOPIC) > 0) {
+        mqtt.addSubscription(PRESENCE_TOPIC, onOccupancy);
+        enabled = true;
+    }
+    if (strlen(PRESENCE_MOTION_TOPIC) > 0) {
+        mqtt.addSubscription(PRESENCE_MOTION_TOPIC, onMotion);
+        motionAt = millis() | 1;  // Start as if someone just walked past
+        enabled = true;
+    }
+    if (enabled) {
+        DEBUG_PRINTLN("Presence gating on");
+    }
+}
+
+bool PresenceGate::isOnPayload(const uint8_t* payload, unsigned int length) {
+    // HA person states are "home", "not_home" or a zone name; binary sensors send on/off
+    static const char* onWords[] = {"home", "on", "occupied", "detected", "true", "1"};
+    for (const char* word : onWords) {
+        if (length == strlen(word) && strncasecmp((const char*)payload, word, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PresenceGate::onOccupancy(const char*, const uint8_t* payload, unsigned int length) {
+    bool home = isOnPayload(payload, length);
+    if (!home && (presence.occupied || !presence.occupancyKnown)) {
+        presence.leftAt = millis();
+    }
+    presence.occupied = home;
+    presence.occupancyKnown = true;
+}
+
+void PresenceGate::onMotion(const char*, const uint8_t* payload, unsigned int length) {
+    if (isOnPayload(payload, length)) {
+        presence.motionAt = millis();
+    }
+}
+
+bool PresenceGate::isPresent() {
+    if (!enabled) return true;
+
+    unsigned long now = millis();
+    bool present;
+    if (motionAt != 0 && now - motionAt < PRESENCE_MOTION_HOLD_MS) {
+        present = true;
+    } else if (strlen(PRESENCE_TOPIC) == 0) {
+        present = false;  // Motion only - no motion for a while means nobody there
+    } else {
+        present = !occupancyKnown || occupied || now - leftAt < PRESENCE_AWAY_GRACE_MS;
+    }
+
+    if (present != wasPresent) {
+        wasPresent = present;
+        DEBUG_PRINTF("Presence: %s\n", present ? "someone home - resuming" : "house empty - suspending fetches");
+        netLog.log(NETLOG_INFO, "presence %s", present ? "arrived" : "away");
+    }
+    return present;
+}
@@ -0,0 +1,277 @@
+#include "punctuality.h"
+#include <esp_attr.h>
+#include <time.h>
+#include "clock_service.h"
+#include "mqtt_ha.h"
+
+// ============================================================================
+// PUNCTUALITY STATISTICS IMPLEMENTATION
+// ============================================================================
+
+PunctualityStats punctuality;
+
+static const uint32_t PUNCTUALITY_MAGIC = 0x9C7A1003;
+static const int PENDING_PER_SLOT = 3;      // Buses per stop shown at once
+static const int COUNTED_PER_SLOT = 4;      // Recently counted buses remembered per stop
+
+struct PendingBus {
+    uint32_t aimedAt;       // 0 = free
+    uint32_t expectedAt;
+    int16_t delay;
+};
+
+struct PunctualitySlot {
+    char route[8];          // "" = free
+    char stop[13];          // ATCO code - up to 12 characters
+    char stopName[24];
+    uint32_t samples;
+    uint32_t onTime;
+    float mean;
+    P2Quantile p50;
+    P2Quantile p90;
+    PendingBus pending[PENDING_PER_SLOT];
+    uint32_t counted[COUNTED_PER_SLOT];     // aimedAt of buses already counted, oldest overwritten
+    uint8_t countedNext;
+};
+
+static RTC_DATA_ATTR uint32_t tableMagic;
+static RTC_DATA_ATTR PunctualitySlot slots[PUNCTUALITY_SLOTS];
+
+// ----------------------------------------------------------------------------
+// P-square estimator
+// ----------------------------------------------------------------------------
+
+void P2Quantile::add(float x, float p) {
+    if (count < 5) {
+        // Warm-up: keep the first five samples sorted
+        int i = count++;
+        while (i > 0 && height[i - 1] > x) {
+            height[i] = height[i - 1];
+            i--;
+        }
+        height[i] = x;
+        if (count == 5) {
+            for (int m = 0; m < 5; m++) pos[m] = m;
+        }
+        return;
+    }
+
+    // Cell the sample falls in, stretching the end markers if needed
+    int k;
+    if (x < height[0]) {
+        height[0] = x;
+        k = 0;
+    } else if (x >= height[4]) {
+        height[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= height[k + 1]) k++;
+    }
+    for (int m = k + 1; m < 5; m++) pos[m]++;
+    count++;
+
+    // Where the markers should be after count samples
+    float n = count - 1;
+    float desired[5] = {0, n * p / 2, n * p, n * (1 + p) / 2, n};
+
+    for (int m = 1; m <= 3; m++) {
+        float d = desired[m] - pos[m];
+        if ((d >= 1 && pos[m + 1] - pos[m] > 1) || (d <= -1 && pos[m - 1] - pos[m] < -1)) {
+            int s = d > 0 ? 1 : -1;
+            // Parabolic step, or linear when that would break the ordering
+            float q = height[m] + (float)s / (pos[m + 1] - pos[m - 1]) *
+                      ((pos[m] - pos[m - 1] + s) * (height[m + 1] - height[m]) / (pos[m + 1] - pos[m]) +
+                       (pos[m + 1] - pos[m] - s) * (height[m] - height[m - 1]) / (pos[m] - pos[m - 1]));
+            if (height[m - 1] < q && q < height[m + 1]) {
+                height[m] = q;
+            } else {
+                height[m] += s * (height[m + s] - height[m]) / (pos[m + s] - pos[m]);
+            }
+            pos[m] += s;
+        }
+    }
+}
+
+float P2Quantile::value(float p) const {
+    if (count == 0) return 0;
+    if (count < 5) return height[(int)roundf((count - 1) * p)];
+    return height[2];
+}
+
+// ----------------------------------------------------------------------------
+// Per route and stop
+// ----------------------------------------------------------------------------
+
+static bool wasCounted(const PunctualitySlot& slot, uint32_t aimedAt) {
+    for (int i = 0; i < COUNTED_PER_SLOT; i++) {
+        if (slot.counted[i] == aimedAt) return true;
+    }
+    return false;
+}
+
+static void countBus(PunctualitySlot& slot, const PendingBus& bus) {
+    // Remembered so the same bus turning up in a later fetch isn't counted again
+    slot.counted[slot.countedNext] = bus.aimedAt;
+    slot.countedNext = (slot.countedNext + 1) % COUNTED_PER_SLOT;
+
+    int delay = bus.delay;
+    slot.samples++;
+    slot.mean += (delay - slot.mean) / slot.samples;
+    if (delay >= -PUNCTUALITY_EARLY_MINUTES && delay <= PUNCTUALITY_LATE_MINUTES) {
+        slot.onTime++;
+    }
+    slot.p50.add(delay, 0.5f);
+    slot.p90.add(delay, 0.9f);
+}
+
+PunctualityStats::PunctualityStats() {
+    memset(published, 0, sizeof(published));
+}
+
+void PunctualityStats::init() {
+    if (tableMagic != PUNCTUALITY_MAGIC) {
+        memset(slots, 0, sizeof(slots));
+        tableMagic = PUNCTUALITY_MAGIC;
+    }
+    DEBUG_PRINTF("Punctuality: %d route/stop pair(s) carried over\n", getTrackedCount());
+}
+
+int PunctualityStats::findSlot(const char* route, const char* stop, bool create) {
+    int free = -1;
+    for (int i = 0; i < PUNCTUALITY_SLOTS; i++) {
+        if (slots[i].route[0] == '\0') {
+            if (free < 0) free = i;
+            continue;
+        }
+        if (strcmp(slots[i].route, route) == 0 && strcmp(slots[i].stop, stop) == 0) return i;
+    }
+    if (!create || free < 0) return -1;
+
+    memset(&slots[free], 0, sizeof(PunctualitySlot));
+    strlcpy(slots[free].route, route, sizeof(slots[free].route));
+    strlcpy(slots[free].stop, stop, sizeof(slots[free].stop));
+    published[free] = LastPublished();
+    return free;
+}
+
+void PunctualityStats::observe(const char* route, const char* stop, const char* stopName,
+                               uint32_t aimedAt, uint32_t expectedAt, int delayMinutes) {
+    // A bus that is due already would be counted by the next settle()
+    // whatever happens to it, and may well have been counted before
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid || expectedAt <= (uint32_t)clock.epoch) return;
+
+    int index = findSlot(route, stop, true);
+    if (index < 0) return;  // Table full - more pairs than configured
+    PunctualitySlot& slot = slots[index];
+    if (wasCounted(slot, aimedAt)) return;  // Counted early when the list was full
+    strlcpy(slot.stopName, stopName, sizeof(slot.stopName));
+
+    // Same bus again - keep only the newest delay
+    PendingBus* target = nullptr;
+    for (int i = 0; i < PENDING_PER_SLOT; i++) {
+        if (slot.pending[i].aimedAt == aimedAt) target = &slot.pending[i];
+    }
+    if (target == nullptr) {
+        for (int i = 0; i < PENDING_PER_SLOT && target == nullptr; i++) {
+            if (slot.pending[i].aimedAt == 0) target = &slot.pending[i];
+        }
+    }
+    if (target == nullptr) {
+        // Out of room - the bus due first is the one closest to its final delay
+        target = &slot.pending[0];
+        for (int i = 1; i < PENDING_PER_SLOT; i++) {
+            if (slot.pending[i].expectedAt < target->expectedAt) target = &slot.pending[i];
+        }
+        countBus(slot, *target);
+    }
+
+    target->aimedAt = aimedAt;
+    target->expectedAt = expectedAt;
+    target->delay = delayMinutes;
+}
+
+void PunctualityStats::settle() {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) return;
+    uint32_t now = (uint32_t)clock.epoch;
+
+    for (int i = 0; i < PUNCTUALITY_SLOTS; i++) {
+        if (slots[i].route[0] == '\0') continue;
+        for (int b = 0; b < PENDING_PER_SLOT; b++) {
+            PendingBus& bus = slots[i].pending[b];
+            if (bus.aimedAt == 0 || bus.expectedAt > now) continue;
+            countBus(slots[i], bus);
+            bus.aimedAt = 0;
+        }
+    }
+}
+
+int PunctualityStats::getTrackedCount() const {
+    int tracked = 0;
+    for (int i = 0; i < PUNCTUALITY_SLOTS; i++) {
+        if (slots[i].route[0] != '\0') tracked++;
+    }
+    return tracked;
+}
+
+void PunctualityStats::publish() {
+    settle();
+    if (!mqtt.isConnected()) return;
+
+    for (int i = 0; i < PUNCTUALITY_SLOTS; i++) {
+        const PunctualitySlot& slot = slots[i];
+        if (slot.route[0] == '\0' || slot.samples < PUNCTUALITY_MIN_SAMPLES) continue;
+
+        float onTime = 100.0f * slot.onTime / slot.samples;
+        float p50 = slot.p50.value(0.5f);
+        float p90 = slot.p90.value(0.9f);
+        LastPublished& last = published[i];
+
+        bool changed = !last.discovered ||
+                       fabsf(slot.mean - last.mean) >= PUNCTUALITY_PUBLISH_DELTA_MIN ||
+                       fabsf(p50 - last.p50) >= PUNCTUALITY_PUBLISH_DELTA_MIN ||
+                       fabsf(p90 - last.p90) >= PUNCTUALITY_PUBLISH_DELTA_MIN ||
+                       fabsf(onTime - last.onTime) >= PUNCTUALITY_PUBLISH_DELTA_PCT;
+        if (!changed) continue;
+
+        char topic[64];
+        snprintf(topic, sizeof(topic), MQTT_PUNCTUALITY_TOPIC "/%s_%s", slot.route, slot.stop);
+
+        if (!last.discovered) {
+            char id[48];
+            char name[64];
+            snprintf(id, sizeof(id), "punct_%s_%s_on_time", slot.route, slot.stop);
+            snprintf(name, sizeof(name), "%s %s On Time", slot.route, slot.stopName);
+            mqtt.publishSensorDiscovery(name, id, nullptr, "%", "{{ value_json.on_time }}",
+                                        "mdi:bus-clock", topic);
+            snprintf(id, sizeof(id), "punct_%s_%s_p50", slot.route, slot.stop);
+            snprintf(name, sizeof(name), "%s %s Typical Delay", slot.route, slot.stopName);
+            mqtt.publishSensorDiscovery(name, id, nullptr, "min", "{{ value_json.p50 }}",
+                                        "mdi:timer-sand", topic);
+            snprintf(id, sizeof(id), "punct_%s_%s_p90", slot.route, slot.stop);
+            snprintf(name, sizeof(name), "%s %s P90 Delay", slot.route, slot.stopName);
+            mqtt.publishSensorDiscovery(name, id, nullptr, "min", "{{ value_json.p90 }}",
+                                        "mdi:timer-alert", topic);
+            snprintf(id, sizeof(id), "punct_%s_%s_mean", slot.route, slot.stop);
+            snprintf(name, sizeof(name), "%s %s Mean Delay", slot.route, slot.stopName);
+            mqtt.publishSensorDiscovery(name, id, nullptr, "min", "{{ value_json.mean }}",
+                                        "mdi:chart-bell-curve", topic);
+        }
+
+        char payload[128];
+        snprintf(payload, sizeof(payload),
+                 "{\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"on_time\":%.0f,\"samples\":%lu}",
+                 slot.mean, p50, p90, onTime, (unsigned long)slot.samples);
+        if (!mqtt.publish(topic, payload, true)) continue;
+
+        last.discovered = true;
+        last.mean = slot.mean;
+        last.p50 = p50;
+        last.p90 = p90;
+        last.onTime = onTime;
+        DEBUG_PRINTF("Punctuality %s @ %s: %.0f%% on time, P50 %.1f, P90 %.1f (%lu buses)\n",
+                     slot.route, slot.stopName, onTime, p50, p90, (unsigned long)slot.samples);
+    }
+}
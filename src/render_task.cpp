@@ -0,0 +1,155 @@
+#include "render_task.h"
+#include "black_box.h"
+
+// ============================================================================
+// RENDER TASK IMPLEMENTATION
+// ============================================================================
+
+RenderTask renderTask;
+
+RenderTask::RenderTask() : busy(false) {
+    handle = nullptr;
+    dropped = 0;
+}
+
+void RenderTask::begin() {
+    if (handle != nullptr) return;
+    if (xTaskCreatePinnedToCore(taskMain, "render", RENDER_TASK_STACK, this,
+                                RENDER_TASK_PRIORITY, &handle, RENDER_TASK_CORE) != pdPASS) {
+        handle = nullptr;
+        DEBUG_PRINTLN("Render task failed to start - drawing inline");
+        return;
+    }
+    DEBUG_PRINTF("Render task on core %d\n", RENDER_TASK_CORE);
+}
+
+RenderCommand* RenderTask::claim(bool mustDeliver) {
+    if (handle == nullptr) return &inlineCommand;
+
+    RenderCommand* cmd = queue.claim();
+    while (cmd == nullptr && mustDeliver) {
+        // Panel is behind - wait for a slot rather than lose a full redraw
+        vTaskDelay(pdMS_TO_TICKS(10));
+        cmd = queue.claim();
+    }
+    if (cmd == nullptr) dropped++;
+    return cmd;
+}
+
+void RenderTask::submit(RenderCommand* cmd) {
+    if (handle == nullptr) {
+        unsigned long start = millis();
+        execute(*cmd);
+        if (cmd->type == RENDER_TIMETABLE && cmd->fetchCycle) {
+            blackBox.noteRender(millis() - start);
+        }
+        return;
+    }
+    queue.publish();
+    xTaskNotifyGive(handle);
+}
+
+void RenderTask::showTimetable(const BusDeparture* departures, int count,
+                               const String& currentTime, const String& direction,
+                               int batteryPercent, bool wifiConnected,
+                               bool placeholderMode, bool forceFullRefresh,
+                               bool fetchCycle) {
+    // A skipped countdown tick is covered by the next one
+    RenderCommand* cmd = claim(forceFullRefresh);
+    if (cmd == nullptr) return;
+
+    cmd->type = RENDER_TIMETABLE;
+    cmd->count = min(count, RENDER_MAX_DEPARTURES);
+    for (int i = 0; i < cmd->count; i++) {
+        cmd->departures[i] = departures[i];
+    }
+    strlcpy(cmd->timeStr, currentTime.c_str(), sizeof(cmd->timeStr));
+    strlcpy(cmd->label, direction.c_str(), sizeof(cmd->label));
+    cmd->batteryPercent = batteryPercent;
+    cmd->wifiConnected = wifiConnected;
+    cmd->placeholder = placeholderMode;
+    cmd->flag = forceFullRefresh;
+    cmd->fetchCycle = fetchCycle;
+    submit(cmd);
+}
+
+void RenderTask::showClock(const String& timeStr) {
+    RenderCommand* cmd = claim(true);
+    cmd->type = RENDER_CLOCK;
+    strlcpy(cmd->timeStr, timeStr.c_str(), sizeof(cmd->timeStr));
+    submit(cmd);
+}
+
+void RenderTask::setWeather(const char* label) {
+    RenderCommand* cmd = claim(true);
+    cmd->type = RENDER_WEATHER;
+    strlcpy(cmd->label, label, sizeof(cmd->label));
+    submit(cmd);
+}
+
+void RenderTask::setInvertedColors(bool inverted) {
+    RenderCommand* cmd = claim(true);
+    cmd->type = RENDER_INVERT;
+    cmd->flag = inverted;
+    submit(cmd);
+}
+
+void RenderTask::setClearCycles(int cycles) {
+    // Read while drawing, so it changes between renders rather than mid-draw
+    RenderCommand* cmd = claim(true);
+    cmd->type = RENDER_CLEAR_CYCLES;
+    cmd->count = cycles;
+    submit(cmd);
+}
+
+void RenderTask::waitIdle() {
+    if (handle == nullptr) return;
+    while (!queue.empty() || busy.load()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+void RenderTask::execute(RenderCommand& cmd) {
+    switch (cmd.type) {
+        case RENDER_TIMETABLE:
+            display.showBusTimetable(cmd.departures, cmd.count, cmd.timeStr, cmd.label,
+                                     cmd.batteryPercent, cmd.wifiConnected,
+                                     cmd.placeholder, cmd.flag);
+            break;
+        case RENDER_CLOCK:
+            display.showClock(cmd.timeStr);
+            break;
+        case RENDER_WEATHER:
+            display.setWeather(cmd.label);
+            break;
+        case RENDER_INVERT:
+            display.setInvertedColors(cmd.flag);
+            break;
+        case RENDER_CLEAR_CYCLES:
+            display.setClearCycles(cmd.count);
+            break;
+    }
+}
+
+void RenderTask::taskMain(void* arg) {
+    RenderTask* self = (RenderTask*)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->busy.store(true);
+        // Everything drained in one wake goes out in one panel power cycle
+        unsigned long start = millis();
+        bool fetchCycle = false;
+        display.beginUpdate();
+        RenderCommand* cmd;
+        while ((cmd = self->queue.peek()) != nullptr) {
+            fetchCycle |= cmd->type == RENDER_TIMETABLE && cmd->fetchCycle;
+            self->execute(*cmd);
+            self->queue.pop();
+        }
+        display.commitUpdate();
+        if (fetchCycle) {
+            blackBox.noteRender(millis() - start);  // Composition and the EPD push
+        }
+        self->busy.store(false);
+    }
+}
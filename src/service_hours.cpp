@@ -0,0 +1,220 @@
+#include "service_hours.h"
+#include <Preferences.h>
+#include <esp_attr.h>
+#include <time.h>
+#include "clock_service.h"
+#include "net_log.h"
+
+// ============================================================================
+// SERVICE HOURS IMPLEMENTATION
+// ============================================================================
+
+ServiceHours serviceHours;
+
+static const uint32_t SIGHTINGS_MAGIC = 0x5E4D1002;
+static const char* DAY_TYPE_NAMES[SERVICE_DAY_TYPES] = {"weekday", "Saturday", "Sunday"};
+
+// What the parser saw for one calendar day, learned once the day is over.
+// Two are enough: today, and tomorrow's early buses seen the evening before.
+struct DaySightings {
+    int32_t dateKey;        // 0 = free
+    uint8_t type;
+    int16_t first;          // Minute of day
+    int16_t last;
+    uint16_t count;
+    int16_t fetchFirst;     // Minute of day of the first and last successful
+    int16_t fetchLast;      // fetch, -1 = none - edges only narrow where we looked
+};
+
+static RTC_DATA_ATTR uint32_t sightingsMagic;
+static RTC_DATA_ATTR DaySightings days[2];
+
+ServiceHours::ServiceHours() {
+    memset(learned, 0, sizeof(learned));
+}
+
+ServiceDayType ServiceHours::dayTypeOf(const struct tm& local) {
+    if (local.tm_wday == 6) return SERVICE_SATURDAY;
+    if (local.tm_wday == 0) return SERVICE_SUNDAY;
+    return SERVICE_WEEKDAY;
+}
+
+int32_t ServiceHours::dateKeyOf(const struct tm& local) {
+    return (local.tm_year + 1900) * 1000 + local.tm_yday;
+}
+
+int ServiceHours::longestWalk() {
+    static const int walks[] = {WALK_TIME_LIBRARY, WALK_TIME_COMMUNITY, WALK_TIME_HARE_HOUNDS,
+                                WALK_TIME_ST_JOHNS, WALK_TIME_CHELTENHAM};
+    int longest = 0;
+    for (int walk : walks) longest = max(longest, walk);
+    return longest;
+}
+
+void ServiceHours::begin() {
+    if (sightingsMagic != SIGHTINGS_MAGIC) {
+        memset(days, 0, sizeof(days));
+        sightingsMagic = SIGHTINGS_MAGIC;
+    }
+
+    Preferences prefs;
+    prefs.begin("service_hrs", true);
+    size_t len = prefs.getBytes("spans", learned, sizeof(learned));
+    prefs.end();
+    if (len != sizeof(learned)) {
+        memset(learned, 0, sizeof(learned));
+    }
+
+    for (int t = 0; t < SERVICE_DAY_TYPES; t++) {
+        if (!learned[t].valid) {
+            DEBUG_PRINTF("Service hours (%s): not learned yet, using %02d:00-%02d:00\n",
+                         DAY_TYPE_NAMES[t], ACTIVE_HOURS_START, ACTIVE_HOURS_END);
+            continue;
+        }
+        int start, end;
+        window((ServiceDayType)t, start, end);
+        DEBUG_PRINTF("Service hours (%s): buses %02d:%02d-%02d:%02d, awake %02d:%02d-%02d:%02d\n",
+                     DAY_TYPE_NAMES[t], learned[t].first / 60, learned[t].first % 60,
+                     learned[t].last / 60, learned[t].last % 60,
+                     start / 60, start % 60, end / 60, end % 60);
+    }
+}
+
+void ServiceHours::window(ServiceDayType type, int& startMinute, int& endMinute) const {
+    startMinute = ACTIVE_HOURS_START * 60;
+    endMinute = ACTIVE_HOURS_END * 60;
+    if (!SERVICE_HOURS_ENABLED || !learned[type].valid) return;
+
+    // Up in time to reach the furthest stop for the first bus, down once the last has gone
+    int start = max(startMinute, learned[type].first - longestWalk() - SERVICE_HOURS_LEAD_MIN);
+    int end = min(endMinute, learned[type].last + 1);
+    if (start < end) {
+        startMinute = start;
+        endMinute = end;
+    }
+}
+
+static DaySightings* dayFor(const struct tm& local) {
+    int32_t key = ServiceHours::dateKeyOf(local);
+    for (int i = 0; i < 2; i++) {
+        if (days[i].dateKey == key) return &days[i];
+    }
+    for (int i = 0; i < 2; i++) {
+        if (days[i].dateKey == 0) {
+            DaySightings* day = &days[i];
+            memset(day, 0, sizeof(DaySightings));
+            day->dateKey = key;
+            day->type = ServiceHours::dayTypeOf(local);
+            day->fetchFirst = -1;
+            day->fetchLast = -1;
+            return day;
+        }
+    }
+    return nullptr;  // Further out than tomorrow
+}
+
+void ServiceHours::observe(uint32_t aimedAt) {
+    if (!SERVICE_HOURS_ENABLED) return;
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) return;
+    roll(dateKeyOf(clock.local));
+
+    time_t when = aimedAt;
+    struct tm local;
+    localtime_r(&when, &local);
+    int minute = local.tm_hour * 60 + local.tm_min;
+
+    DaySightings* day = dayFor(local);
+    if (day == nullptr) return;
+
+    if (day->count == 0 || minute < day->first) day->first = minute;
+    if (day->count == 0 || minute > day->last) day->last = minute;
+    if (day->count < 0xFFFF) day->count++;
+}
+
+void ServiceHours::noteFetch() {
+    if (!SERVICE_HOURS_ENABLED) return;
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) return;
+    roll(dateKeyOf(clock.local));
+
+    DaySightings* day = dayFor(clock.local);
+    if (day == nullptr) return;
+    if (day->fetchFirst < 0) day->fetchFirst = clock.minuteOfDay;
+    day->fetchLast = clock.minuteOfDay;
+}
+
+void ServiceHours::roll(int32_t todayKey) {
+    for (int i = 0; i < 2; i++) {
+        if (days[i].dateKey == 0 || days[i].dateKey >= todayKey) continue;
+        learn(i);
+        days[i].dateKey = 0;
+    }
+}
+
+void ServiceHours::learn(int index) {
+    const DaySightings& day = days[index];
+    const char* name = DAY_TYPE_NAMES[day.type];
+    if (day.count < SERVICE_HOURS_MIN_SIGHTINGS) {
+        DEBUG_PRINTF("Service hours (%s): only %u sighting(s) - day not used\n", name, (unsigned)day.count);
+        return;
+    }
+
+    Span& span = learned[day.type];
+    Span before = span;
+    if (!span.valid) {
+        span.first = day.first;
+        span.last = day.last;
+        span.valid = 1;
+    } else {
+        // Widen at once - a bus was there. Narrow slowly, and only where the
+        // fetches covered the edge: the window keeps us from fetching before
+        // it opens, so a late first sighting after a reboot or an away
+        // morning says nothing about the first bus.
+        if (day.first < span.first) {
+            span.first = day.first;
+        } else if (day.fetchFirst >= 0 && day.fetchFirst < span.first) {
+            span.first = (int16_t)min((int)day.first, span.first + SERVICE_HOURS_SHRINK_MIN);
+        }
+        if (day.last > span.last) {
+            span.last = day.last;
+        } else if (day.fetchLast > span.last) {
+            span.last = (int16_t)max((int)day.last, span.last - SERVICE_HOURS_SHRINK_MIN);
+        }
+    }
+
+    if (memcmp(&before, &span, sizeof(Span)) == 0) return;
+    save();
+    netLog.log(NETLOG_INFO, "service hours %s: %02d:%02d-%02d:%02d (seen %02d:%02d-%02d:%02d, %u sightings)",
+               name, span.first / 60, span.first % 60, span.last / 60, span.last % 60,
+               day.first / 60, day.first % 60, day.last / 60, day.last % 60, (unsigned)day.count);
+}
+
+void ServiceHours::save() {
+    Preferences prefs;
+    prefs.begin("service_hrs", false);
+    prefs.putBytes("spans", learned, sizeof(learned));
+    prefs.end();
+}
+
+bool ServiceHours::isActive() {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
+        return true; // Default to active if time unknown
+    }
+    roll(dateKeyOf(clock.local));
+
+    int start, end;
+    window(dayTypeOf(clock.local), start, end);
+    return clock.minuteOfDay >= start && clock.minuteOfDay < end;
+}
+
+void ServiceHours::today(int& startMinute, int& endMinute) {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
+        startMinute = ACTIVE_HOURS_START * 60;
+        endMinute = ACTIVE_HOURS_END * 60;
+        return;
+    }
+    window(dayTypeOf(clock.local), startMinute, endMinute);
+}
@@ -1,4 +1,10 @@
 #include "transport_api.h"
+#include "black_box.h"
+#include "clock_service.h"
+#include "service_hours.h"
+#include "dns_cache.h"
+#include "gzip_decoder.h"
+#include "cycle_arena.h"
 
 // ============================================================================
 // TRANSPORT API CLIENT IMPLEMENTATION
@@ -54,6 +60,7 @@ bool TransportAPIClient::isValidRouteForStop(const String& route, const char* st
 TransportAPIClient::TransportAPIClient() {
     currentDirection = TO_CHELTENHAM;
     lastApiCallCount = 0;
+    stopMask = 0xFF;
 }
 
 void TransportAPIClient::init() {
@@ -71,6 +78,10 @@ Direction TransportAPIClient::getDirection() const {
     return currentDirection;
 }
 
+void TransportAPIClient::setStopMask(uint8_t mask) {
+    stopMask = mask;
+}
+
 String TransportAPIClient::getDirectionLabel() const {
     return currentDirection == TO_CHELTENHAM ? "Cheltenham Spa" : "Churchdown";
 }
@@ -80,12 +91,8 @@ String TransportAPIClient::getLastError() const {
 }
 
 bool TransportAPIClient::isActiveHours() const {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        return true; // Default to active if time unknown
-    }
-    int hour = timeinfo.tm_hour;
-    return (hour >= ACTIVE_HOURS_START && hour < ACTIVE_HOURS_END);
+    // Learned service span for today, within ACTIVE_HOURS_START/END
+    return serviceHours.isActive();
 }
 
 String TransportAPIClient::buildUrl(const char* atcocode) {
@@ -129,6 +136,12 @@ bool TransportAPIClient::fetchDepartures(Direction direction, BusDeparture* depa
     bool fetchedAllStops = false;
     
     for (int i = 0; i < stopCount; i++) {
+        // Stops the direction profile leaves out
+        if (!forceFetchAll && !(stopMask & (1 << i))) {
+            if (i == stopCount - 1) fetchedAllStops = true;
+            continue;
+        }
+        
         String url = buildUrl(stops[i].atcocode);
         DEBUG_PRINTF("Fetching: %s (stop %d/%d)\n", stops[i].name, i + 1, stopCount);
         
@@ -138,11 +151,21 @@ bool TransportAPIClient::fetchDepartures(Direction direction, BusDeparture* depa
         const int MAX_RETRIES = 2;
         
         while (retries <= MAX_RETRIES && httpCode != HTTP_CODE_OK) {
+            dnsCache.connect(secureClient, TRANSPORT_API_HOST, 443);  // Skips the DNS lookup in begin()
             http.begin(secureClient, url);
             http.setTimeout(15000);
             http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+            clockService.watchDateHeader(http);
+            #if TRANSPORT_API_GZIP
+            GzipDecoder::accept(http);
+            #endif
             
+            blackBox.markPhase(PHASE_HTTP);
             httpCode = http.GET();
+            blackBox.noteHttpCode(httpCode);
+            if (httpCode > 0) {
+                clockService.syncFromResponse(http);  // Before parsing, which needs the time
+            }
             
             if (httpCode != HTTP_CODE_OK && retries < MAX_RETRIES) {
                 DEBUG_PRINTF("HTTP error for %s: %d, retrying... (%d/%d)\n", stops[i].name, httpCode, retries + 1, MAX_RETRIES);
@@ -157,7 +180,10 @@ bool TransportAPIClient::fetchDepartures(Direction direction, BusDeparture* depa
         lastApiCallCount++;  // Count this API call (even if failed after retries)
         
         if (httpCode == HTTP_CODE_OK) {
-            String response = http.getString();
+            String response;
+            if (!gzipDecoder.readBody(http, response)) {
+                DEBUG_PRINTF("Failed to read response body for %s\n", stops[i].name);
+            }
             
             // DEBUG: Print first 500 chars of response to see structure
             DEBUG_PRINTF("API Response for %s (first 500 chars):\n", stops[i].name);
@@ -165,9 +191,12 @@ bool TransportAPIClient::fetchDepartures(Direction direction, BusDeparture* depa
             DEBUG_PRINTLN(preview);
             DEBUG_PRINTLN("---");
             
+            blackBox.markPhase(PHASE_PARSE);
+            size_t stopMark = cycleArena.mark();
             if (!parseStopDepartures(response, stops[i], departures, count, maxDepartures)) {
                 DEBUG_PRINTF("Warning: Failed to parse departures for %s (may be no buses running)\n", stops[i].name);
             }
+            cycleArena.rewind(stopMark);  // Drops this stop's JSON document
             
             // Check if we got any departures from this stop
             // (This helps diagnose if API returned data but no matching routes)
@@ -336,7 +365,7 @@ int TransportAPIClient::getLastApiCallCount() const {
 bool TransportAPIClient::parseStopDepartures(const String& jsonResponse, const BusStop& stop,
                                               BusDeparture* departures, int& currentCount, 
                                               int maxCount) {
-    JsonDocument doc;
+    JsonDocument doc(&cycleArena);
     DeserializationError error = deserializeJson(doc, jsonResponse);
     
     if (error) {
@@ -436,13 +465,21 @@ bool TransportAPIClient::parseStopDepartures(const String& jsonResponse, const B
                 
                 // Determine if live or scheduled
                 bool isLive = expectedTime.length() > 0;
+                int aimedMinutes = minutesUntil;
+                if (aimedTime.length() > 0) {
+                    String unused;
+                    parseDepartureTime(aimedTime, "", unused, aimedMinutes);
+                }
+                
+                // Timetabled time feeds the learned service span
+                const ClockSnapshot& clock = clockService.now();
+                if (clock.valid) {
+                    serviceHours.observe((uint32_t)clock.epoch - clock.local.tm_sec + aimedMinutes * 60);
+                }
                 
                 // Calculate delay
                 String statusText = "";
                 if (isLive && aimedTime.length() > 0) {
-                    String unused;
-                    int aimedMinutes;
-                    parseDepartureTime(aimedTime, "", unused, aimedMinutes);
                     int delay = minutesUntil - aimedMinutes;
                     if (delay >= 2) {
                         statusText = "Delayed " + String(delay) + " min";
@@ -479,8 +516,8 @@ bool TransportAPIClient::parseStopDepartures(const String& jsonResponse, const B
 
 void TransportAPIClient::parseDepartureTime(const String& timeStr, const String& estimateStr,
                                              String& displayTime, int& minutesUntil) {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
+    const ClockSnapshot& clock = clockService.now();
+    if (!clock.valid) {
         displayTime = timeStr.length() > 0 ? timeStr : "??:??";
         minutesUntil = 0;
         return;
@@ -501,7 +538,7 @@ void TransportAPIClient::parseDepartureTime(const String& timeStr, const String&
         int depHour = actualTimeStr.substring(0, 2).toInt();
         int depMin = actualTimeStr.substring(3, 5).toInt();
         
-        int nowMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+        int nowMinutes = clock.minuteOfDay;
         int depMinutes = depHour * 60 + depMin;
         
         // Handle overnight
@@ -0,0 +1,177 @@
+#include "volatility.h"
+#include "clock_service.h"
+
+// ============================================================================
+// DATA VOLATILITY TRACKER IMPLEMENTATION
+// ============================================================================
+
+VolatilityTracker volatility;
+
+VolatilityTracker::VolatilityTracker() {
+    memset(state, 0, sizeof(state));
+    lastChanges = 0;
+}
+
+uint32_t VolatilityTracker::hash(const char* text, uint32_t seed) {
+    uint32_t h = seed;
+    while (*text) {
+        h ^= (uint8_t)*text++;
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+int VolatilityTracker::departureMinute(const BusDeparture& departure) {
+    if (departure.departureTime.length() < 5) return -1;
+    return departure.departureTime.substring(0, 2).toInt() * 60 +
+           departure.departureTime.substring(3, 5).toInt();
+}
+
+VolatilityTracker::StopScore* VolatilityTracker::stopScore(DirectionState& s, uint32_t stopKey) {
+    StopScore* free = nullptr;
+    for (int i = 0; i < VOLATILITY_MAX_STOPS; i++) {
+        if (s.stops[i].stopKey == stopKey) return &s.stops[i];
+        if (s.stops[i].stopKey == 0 && free == nullptr) free = &s.stops[i];
+    }
+    if (free) {
+        free->stopKey = stopKey;
+        free->score = 0;  // Unknown stop - no movement seen yet, so no tightening
+    }
+    return free;
+}
+
+void VolatilityTracker::update(Direction dir, const BusDeparture* departures, int count) {
+    DirectionState& s = state[dir == TO_CHELTENHAM ? 0 : 1];
+    const ClockSnapshot& clock = clockService.now();
+
+    SnapshotEntry fresh[VOLATILITY_SNAPSHOT_SIZE];
+    uint32_t freshStops[VOLATILITY_SNAPSHOT_SIZE];
+    int freshCount = 0;
+    for (int i = 0; i < count && freshCount < VOLATILITY_SNAPSHOT_SIZE; i++) {
+        uint32_t stopKey = hash(departures[i].stopName.c_str());
+        freshStops[freshCount] = stopKey;
+        fresh[freshCount].key = hash(departures[i].busNumber.c_str(), stopKey);
+        fresh[freshCount].stopKey = stopKey;
+        fresh[freshCount].minute = departureMinute(departures[i]);
+        fresh[freshCount].walk = departures[i].walkingTimeMinutes;
+        fresh[freshCount].live = departures[i].isLive;
+        freshCount++;
+    }
+
+    if (s.primed) {
+        // Changes and departures seen per stop this time
+        uint32_t stopKeys[VOLATILITY_MAX_STOPS] = {};
+        int stopChanges[VOLATILITY_MAX_STOPS] = {};
+        int stopSeen[VOLATILITY_MAX_STOPS] = {};
+        bool matched[VOLATILITY_SNAPSHOT_SIZE] = {};
+        bool departed[VOLATILITY_SNAPSHOT_SIZE] = {};
+        int changes = 0;
+
+        auto tally = [&](uint32_t stopKey, int changed) {
+            for (int k = 0; k < VOLATILITY_MAX_STOPS; k++) {
+                if (stopKeys[k] == 0) stopKeys[k] = stopKey;
+                if (stopKeys[k] == stopKey) {
+                    stopChanges[k] += changed;
+                    stopSeen[k]++;
+                    return;
+                }
+            }
+        };
+
+        // Minutes from now, so the comparisons survive midnight
+        auto ahead = [&](int minute) {
+            if (!clock.valid || minute < 0) return minute;
+            return (minute - clock.minuteOfDay + 1440) % 1440;
+        };
+
+        // Buses that have left take no part - a frequent route would
+        // otherwise pair every bus with the one before it
+        for (int j = 0; j < s.count; j++) {
+            if (clock.valid && s.entries[j].minute >= 0 && ahead(s.entries[j].minute) > 720) {
+                departed[j] = true;
+            }
+        }
+
+        // Pair each fresh bus with the nearest unmatched old one of the same
+        // route and stop
+        for (int i = 0; i < freshCount; i++) {
+            int best = -1;
+            int bestShift = 0;
+            for (int j = 0; j < s.count; j++) {
+                if (matched[j] || departed[j] || s.entries[j].key != fresh[i].key) continue;
+                int shift = abs(ahead(fresh[i].minute) - ahead(s.entries[j].minute));
+                if (best < 0 || shift < bestShift) {
+                    best = j;
+                    bestShift = shift;
+                }
+            }
+            int changed = 1;  // Added
+            if (best >= 0) {
+                matched[best] = true;
+                changed = (bestShift >= VOLATILITY_SHIFT_MINUTES || fresh[i].live != s.entries[best].live) ? 1 : 0;
+            } else {
+                // A bus beyond the last one this stop showed before has just
+                // come into view as earlier ones left - not a change
+                int horizon = -1;
+                for (int j = 0; j < s.count; j++) {
+                    if (departed[j] || s.entries[j].stopKey != fresh[i].stopKey) continue;
+                    horizon = max(horizon, ahead(s.entries[j].minute));
+                }
+                if (horizon >= 0 && ahead(fresh[i].minute) > horizon) changed = 0;
+            }
+            changes += changed;
+            tally(freshStops[i], changed);
+        }
+
+        // Old buses missing now - departed ones were set aside above, and
+        // ones now closer than their walk were dropped by the parser
+        for (int j = 0; j < s.count; j++) {
+            if (matched[j] || departed[j]) continue;
+            if (clock.valid && s.entries[j].minute >= 0 && ahead(s.entries[j].minute) < s.entries[j].walk) {
+                continue;  // Too late to walk to
+            }
+            changes++;
+        }
+
+        for (int k = 0; k < VOLATILITY_MAX_STOPS && stopKeys[k] != 0; k++) {
+            StopScore* score = stopScore(s, stopKeys[k]);
+            if (score == nullptr) continue;
+            float ratio = (float)stopChanges[k] / stopSeen[k];
+            score->score += (ratio - score->score) * VOLATILITY_SMOOTHING;
+        }
+
+        s.unchangedStreak = changes == 0 ? s.unchangedStreak + 1 : 0;
+        lastChanges = changes;
+        DEBUG_PRINTF("Volatility: %d change(s), %d unchanged in a row, interval x%.2f\n",
+                     changes, s.unchangedStreak, intervalScale(dir));
+    }
+
+    memcpy(s.entries, fresh, sizeof(SnapshotEntry) * freshCount);
+    s.count = freshCount;
+    s.primed = true;
+}
+
+int VolatilityTracker::getUnchangedStreak(Direction dir) const {
+    return state[dir == TO_CHELTENHAM ? 0 : 1].unchangedStreak;
+}
+
+float VolatilityTracker::intervalScale(Direction dir) const {
+    const DirectionState& s = state[dir == TO_CHELTENHAM ? 0 : 1];
+    if (!s.primed) return 1.0f;
+
+    // Identical fetches in a row - double the gap each time
+    if (s.unchangedStreak > 0) {
+        float scale = 1.0f;
+        for (int i = 0; i < s.unchangedStreak && scale < VOLATILITY_MAX_BACKOFF; i++) scale *= 2;
+        return min(scale, (float)VOLATILITY_MAX_BACKOFF);
+    }
+
+    // Otherwise follow the busiest stop: moving live times pull the gap in
+    float busiest = 0;
+    for (int i = 0; i < VOLATILITY_MAX_STOPS; i++) {
+        if (s.stops[i].stopKey != 0 && s.stops[i].score > busiest) busiest = s.stops[i].score;
+    }
+    if (busiest >= VOLATILITY_HIGH_SCORE) return VOLATILITY_MIN_SCALE;
+    // Linear from 1.0 at no change to the minimum at the high score
+    return 1.0f - (1.0f - VOLATILITY_MIN_SCALE) * busiest / VOLATILITY_HIGH_SCORE;
+}
@@ -1,7 +1,9 @@
 #include "weather.h"
 #include "config.h"
+#include "dns_cache.h"
+#include "clock_service.h"
+#include "cycle_arena.h"
 #include <HTTPClient.h>
-#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 
 WeatherClient weatherClient;
@@ -9,70 +11,105 @@ WeatherClient weatherClient;
 WeatherClient::WeatherClient() {
     currentWeather.valid = false;
     currentWeather.temperature = 0;
-    currentWeather.humidity = 0;
-    currentWeather.condition = "";
-    lastError = "";
+    currentWeather.condition[0] = '\0';
+    currentWeather.icon[0] = '\0';
+    currentWeather.fetchedAt = 0;
+    lastError[0] = '\0';
+}
+
+void WeatherClient::init() {
+    secureClient.setInsecure();
 }
 
 bool WeatherClient::fetchWeather() {
-    String apiKey = String(WEATHER_API_KEY);
-    if (apiKey.length() < 10) {
-        lastError = "No API key";
+    if (strlen(WEATHER_API_KEY) < 10) {
+        strlcpy(lastError, "No API key", sizeof(lastError));
         return false;
     }
-    
-    WiFiClientSecure client;
-    client.setInsecure();
-    
+
+    char url[192];
+    snprintf(url, sizeof(url),
+             "https://%s/data/2.5/weather?lat=%s&lon=%s&units=metric&appid=%s",
+             WEATHER_API_HOST, WEATHER_LAT_STR, WEATHER_LON_STR, WEATHER_API_KEY);
+
+    DEBUG_PRINTLN("Fetching weather...");
+
     HTTPClient http;
-    
-    String url = "https://api.openweathermap.org/data/2.5/weather?lat=";
-    url += String(WEATHER_LAT_STR);
-    url += "&lon=";
-    url += String(WEATHER_LON_STR);
-    url += "&units=metric&appid=";
-    url += String(WEATHER_API_KEY);
-    
-    DEBUG_PRINTF("Fetching weather from: %s\n", url.c_str());
-    
-    http.begin(client, url);
+    dnsCache.connect(secureClient, WEATHER_API_HOST, 443);  // Skips the DNS lookup in begin()
+    http.begin(secureClient, url);
     http.setTimeout(10000);
-    
+    http.useHTTP10(true);  // No chunked encoding, so the body can be parsed off the socket
+    clockService.watchDateHeader(http);
+
     int httpCode = http.GET();
-    
+    if (httpCode > 0) {
+        clockService.syncFromResponse(http);
+    }
+
     if (httpCode == HTTP_CODE_OK) {
-        String response = http.getString();
+        bool ok = parseResponse(http.getStream());
         http.end();
-        return parseResponse(response);
+        return ok;
     }
-    
-    lastError = "HTTP " + String(httpCode);
+
+    snprintf(lastError, sizeof(lastError), "HTTP %d", httpCode);
     DEBUG_PRINTF("Weather API error: %d\n", httpCode);
     http.end();
     return false;
 }
 
-bool WeatherClient::parseResponse(const String& json) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, json);
-    
+bool WeatherClient::parseResponse(Stream& stream) {
+    // Parse memory comes from the cycle arena and is dropped before returning
+    size_t arenaMark = cycleArena.mark();
+    bool ok = parseDocument(stream);
+    cycleArena.rewind(arenaMark);
+    return ok;
+}
+
+bool WeatherClient::parseDocument(Stream& stream) {
+    JsonDocument filter(&cycleArena);
+    filter["main"]["temp"] = true;
+    filter["weather"][0]["main"] = true;
+    filter["weather"][0]["icon"] = true;
+
+    JsonDocument doc(&cycleArena);
+    DeserializationError error = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+
     if (error) {
-        lastError = "JSON error";
+        strlcpy(lastError, "JSON error", sizeof(lastError));
         DEBUG_PRINTF("Weather JSON error: %s\n", error.c_str());
         return false;
     }
-    
+
     currentWeather.temperature = doc["main"]["temp"].as<float>();
-    currentWeather.humidity = doc["main"]["humidity"].as<int>();
-    currentWeather.condition = doc["weather"][0]["main"].as<String>();
-    currentWeather.icon = doc["weather"][0]["icon"].as<String>();
+    strlcpy(currentWeather.condition, doc["weather"][0]["main"] | "", sizeof(currentWeather.condition));
+    strlcpy(currentWeather.icon, doc["weather"][0]["icon"] | "", sizeof(currentWeather.icon));
+    currentWeather.fetchedAt = millis();
     currentWeather.valid = true;
-    
-    DEBUG_PRINTF("Weather: %.1f°C, %s, %d%% humidity\n", 
-                 currentWeather.temperature, 
-                 currentWeather.condition.c_str(),
-                 currentWeather.humidity);
-    
+    lastError[0] = '\0';
+
+    DEBUG_PRINTF("Weather: %.1fC, %s (%s)\n",
+                 currentWeather.temperature,
+                 currentWeather.condition,
+                 currentWeather.icon);
+
     return true;
 }
 
+bool WeatherClient::isFresh() const {
+    return currentWeather.valid && millis() - currentWeather.fetchedAt < WEATHER_CACHE_TTL_MS;
+}
+
+void WeatherClient::formatLabel(char* out, size_t outSize) const {
+    if (!isFresh()) {
+        out[0] = '\0';
+        return;
+    }
+
+    // The header fonts are ASCII only, so no degree sign
+    const char* condition = currentWeather.condition;
+    if (strcmp(condition, "Thunderstorm") == 0) {
+        condition = "Storm";
+    }
+    snprintf(out, outSize, "%dC %s", (int)lroundf(currentWeather.temperature), condition);
+}
@@ -0,0 +1,169 @@
+#include "wifi_fast.h"
+#include <Preferences.h>
+#include <esp_attr.h>
+#include "net_log.h"
+
+// ============================================================================
+// FAST WIFI CONNECT IMPLEMENTATION
+// ============================================================================
+
+FastWiFi fastWiFi;
+
+static const uint32_t LINK_CACHE_MAGIC = 0x57494649;  // "WIFI"
+
+struct WiFiLinkCache {
+    uint32_t magic;
+    char ssid[33];
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;            // DHCP lease (or static address) last used
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+// Survives deep sleep; NVS holds the same entry across power cycles
+static RTC_DATA_ATTR WiFiLinkCache rtcCache;
+
+FastWiFi::FastWiFi() {
+    lastConnectMs = 0;
+    lastFast = false;
+}
+
+bool FastWiFi::loadCache(WiFiLinkCache& cache) {
+    cache = rtcCache;
+    if (cache.magic == LINK_CACHE_MAGIC) {
+        return true;
+    }
+
+    Preferences prefs;
+    prefs.begin("wifi_fast", true);
+    size_t len = prefs.getBytes("link", &cache, sizeof(cache));
+    prefs.end();
+    if (len == sizeof(cache) && cache.magic == LINK_CACHE_MAGIC) {
+        rtcCache = cache;
+        return true;
+    }
+    return false;
+}
+
+void FastWiFi::saveCache(const char* ssid) {
+    WiFiLinkCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = LINK_CACHE_MAGIC;
+    strlcpy(cache.ssid, ssid, sizeof(cache.ssid));
+    uint8_t* bssid = WiFi.BSSID();
+    if (bssid) memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.ip = (uint32_t)WiFi.localIP();
+    cache.gateway = (uint32_t)WiFi.gatewayIP();
+    cache.subnet = (uint32_t)WiFi.subnetMask();
+    cache.dns = (uint32_t)WiFi.dnsIP();
+
+    // Only touch flash when the link actually changed
+    if (memcmp(&cache, &rtcCache, sizeof(cache)) == 0) return;
+    rtcCache = cache;
+
+    Preferences prefs;
+    prefs.begin("wifi_fast", false);
+    prefs.putBytes("link", &cache, sizeof(cache));
+    prefs.end();
+    DEBUG_PRINTF("WiFi: cached AP %s on channel %d\n", WiFi.BSSIDstr().c_str(), (int)cache.channel);
+}
+
+void FastWiFi::forget() {
+    memset(&rtcCache, 0, sizeof(rtcCache));
+    Preferences prefs;
+    prefs.begin("wifi_fast", false);
+    prefs.remove("link");
+    prefs.end();
+}
+
+void FastWiFi::applyIpConfig(const WiFiLinkCache* cache) {
+    IPAddress ip, gateway, subnet, dns;
+    if (strlen(WIFI_STATIC_IP) > 0 &&
+        ip.fromString(WIFI_STATIC_IP) && gateway.fromString(WIFI_STATIC_GATEWAY) &&
+        subnet.fromString(WIFI_STATIC_SUBNET)) {
+        if (!dns.fromString(WIFI_STATIC_DNS)) dns = gateway;
+        WiFi.config(ip, gateway, subnet, dns);
+        return;
+    }
+
+    if (WIFI_REUSE_LAST_IP && cache && cache->ip != 0) {
+        // Skip DHCP by reusing the previous lease
+        WiFi.config(IPAddress(cache->ip), IPAddress(cache->gateway),
+                    IPAddress(cache->subnet), IPAddress(cache->dns));
+        return;
+    }
+
+    // DHCP
+    WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+}
+
+bool FastWiFi::waitForConnection(unsigned long startTime, int timeoutMs) {
+    // Short polls so the measured latency is accurate
+    while (WiFi.status() != WL_CONNECTED && (millis() - startTime) < (unsigned long)timeoutMs) {
+        delay(20);
+    }
+    return WiFi.status() == WL_CONNECTED;
+}
+
+bool FastWiFi::beginConnect(const char* ssid, const char* password, bool allowFast) {
+    WiFi.persistent(false);  // We keep our own cache - don't rewrite the SDK's flash copy
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(false);
+
+    WiFiLinkCache cache;
+    if (allowFast && loadCache(cache) && strcmp(cache.ssid, ssid) == 0 && cache.channel > 0) {
+        // Direct association: known channel and BSSID, no scan
+        DEBUG_PRINTF("Connecting to %s (fast: channel %d)...\n", ssid, (int)cache.channel);
+        applyIpConfig(&cache);
+        WiFi.begin(ssid, password, cache.channel, cache.bssid, true);
+        return true;
+    }
+
+    // Full scan and association
+    DEBUG_PRINTF("Connecting to %s...\n", ssid);
+    applyIpConfig(nullptr);
+    WiFi.begin(ssid, password);
+    return false;
+}
+
+void FastWiFi::noteConnected(const char* ssid, unsigned long startTime, bool fast) {
+    lastConnectMs = millis() - startTime;
+    lastFast = fast;
+    DEBUG_PRINTF("WiFi connected in %lu ms (%s)\n", lastConnectMs, fast ? "fast path" : "full scan");
+    netLog.log(NETLOG_INFO, "wifi connected in %lu ms (%s, ch %d)", lastConnectMs,
+               fast ? "fast" : "scan", (int)WiFi.channel());
+    saveCache(ssid);
+}
+
+bool FastWiFi::connect(const char* ssid, const char* password, int timeoutMs) {
+    unsigned long startTime = millis();
+
+    if (beginConnect(ssid, password, true)) {
+        if (waitForConnection(startTime, WIFI_FAST_CONNECT_TIMEOUT_MS)) {
+            noteConnected(ssid, startTime, true);
+            return true;
+        }
+        DEBUG_PRINTLN("Fast connect failed - falling back to full scan");
+        netLog.log(NETLOG_WARNING, "wifi fast connect failed after %lu ms, scanning", millis() - startTime);
+        WiFi.disconnect(true);
+        delay(100);
+        beginConnect(ssid, password, false);
+    }
+
+    if (!waitForConnection(millis(), timeoutMs)) {
+        return false;
+    }
+    noteConnected(ssid, startTime, false);
+    return true;
+}
+
+unsigned long FastWiFi::getLastConnectMs() const {
+    return lastConnectMs;
+}
+
+bool FastWiFi::lastConnectWasFast() const {
+    return lastFast;
+}